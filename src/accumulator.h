@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <type_traits>
+
+#include "algorithms.h"
+#include "simd.h"
+
+namespace top_two
+{
+    // Reduces data that arrives in chunks, with constant memory. Partial accumulators, e.g. one per
+    // thread or per connection, are combined with merge(), which uses the merge logic of
+    // parallel::ReduceOp.
+    template <typename T = int32_t, typename Compare = Less<T>>
+    class TopTwoAccumulator
+    {
+    public:
+        using TRes = TBasicResult<T, Compare>;
+
+        // Chunks are reduced with the simd kernel if one exists for the element type and comparator.
+        void push(std::span<T const> values)
+        {
+            if constexpr (std::is_same_v<Compare, Less<T>>)
+            {
+                state = parallel::ReduceOp<T, Compare>{}(state, simd::detail::kernel<T>(isa)(values.data(), values.data() + values.size()));
+            }
+            else
+            {
+                state = std::accumulate(values.begin(), values.end(), state, parallel::ReduceOp<T, Compare>{});
+            }
+        }
+
+        void push(T value)
+        {
+            state = parallel::ReduceOp<T, Compare>{}(state, value);
+        }
+
+        void merge(TopTwoAccumulator const &other)
+        {
+            state = parallel::ReduceOp<T, Compare>{}(state, other.state);
+        }
+
+        TRes result() const
+        {
+            return detail::finish(state);
+        }
+
+        void reset()
+        {
+            state = TRes{};
+        }
+
+    private:
+        TRes state;
+        simd::Isa isa = simd::best_isa();
+    };
+}
@@ -1,80 +1,315 @@
+#pragma once
+
 #include <algorithm>
+#include <cstdint>
 #include <execution>
+#include <limits>
 #include <numeric>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 namespace top_two
 {
-    struct TResult
+    // Ordering of floating-point NaN values relative to all other values.
+    enum class NanPolicy
+    {
+        ignore,    // NaN is smaller than every other value and never becomes part of a result
+        largest,   // NaN is larger than every other value
+        propagate  // NaN is larger than every other value and turns both values of a result into NaN
+    };
+
+    // Comparators define the order of the values and the value every result starts from.
+    // Custom comparators must provide the same members.
+    template <typename T, NanPolicy Policy = NanPolicy::ignore>
+    struct Less
+    {
+        constexpr static NanPolicy nan_policy = Policy;
+
+        constexpr static T lowest()
+        {
+            if constexpr (std::numeric_limits<T>::has_infinity)
+            {
+                return -std::numeric_limits<T>::infinity();
+            }
+            else
+            {
+                return std::numeric_limits<T>::lowest();
+            }
+        }
+
+        constexpr bool operator()(T lhs, T rhs) const
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                if (lhs != lhs || rhs != rhs)
+                {
+                    return Policy == NanPolicy::ignore ? rhs == rhs : lhs == lhs;
+                }
+            }
+            return lhs < rhs;
+        }
+    };
+
+    // Reversed order, i.e. the result holds the smallest and the second smallest value.
+    template <typename T, NanPolicy Policy = NanPolicy::ignore>
+    struct Greater
     {
-        int32_t second_largest = std::numeric_limits<int32_t>::min();
-        int32_t largest = std::numeric_limits<int32_t>::min();
+        constexpr static NanPolicy nan_policy = Policy;
 
-        bool operator==(const TResult &other) const
+        constexpr static T lowest()
         {
-            return (second_largest == other.second_largest && largest == other.largest);
+            if constexpr (std::numeric_limits<T>::has_infinity)
+            {
+                return std::numeric_limits<T>::infinity();
+            }
+            else
+            {
+                return std::numeric_limits<T>::max();
+            }
         }
 
-        TResult() = default;
-        TResult(int32_t second_largest_, int32_t largest_) : second_largest(second_largest_), largest(largest_) {}
-        TResult(int32_t val) : second_largest(val), largest(val) {}  // necessary to satisfy static_assert in implementation of std::reduce (fixed in g++ 12.1)
+        constexpr bool operator()(T lhs, T rhs) const
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                if (lhs != lhs || rhs != rhs)
+                {
+                    return Policy == NanPolicy::ignore ? rhs == rhs : lhs == lhs;
+                }
+            }
+            return rhs < lhs;
+        }
     };
 
+    template <typename T, typename Compare = Less<T>>
+    struct TBasicResult
+    {
+        using value_type = T;
+        using compare_type = Compare;
+
+        T second_largest = Compare::lowest();
+        T largest = Compare::lowest();
+
+        constexpr bool operator==(const TBasicResult &other) const
+        {
+            return (equivalent(second_largest, other.second_largest) && equivalent(largest, other.largest));
+        }
+
+        TBasicResult() = default;
+        constexpr TBasicResult(T second_largest_, T largest_) : second_largest(second_largest_), largest(largest_) {}
+        constexpr TBasicResult(T val) : second_largest(val), largest(val) {}  // necessary to satisfy static_assert in implementation of std::reduce (fixed in g++ 12.1)
+
+    private:
+        // NaN is equivalent to NaN under every NanPolicy
+        constexpr static bool equivalent(T lhs, T rhs)
+        {
+            return !Compare{}(lhs, rhs) && !Compare{}(rhs, lhs);
+        }
+    };
+
+    using TResult = TBasicResult<int32_t>;
+
+    // Reusable buffer for the algorithms that permute their input. Keep one per thread and pass
+    // copy_of(values) to an *_in_place algorithm: once the buffer has grown to the largest input,
+    // a query does not allocate any memory.
+    template <typename T>
+    class TScratchBuffer
+    {
+    public:
+        std::span<T> copy_of(std::span<T const> values)
+        {
+            if (buffer.size() < values.size())
+            {
+                buffer.resize(values.size());
+            }
+            std::copy(values.begin(), values.end(), buffer.begin());
+            return {buffer.data(), values.size()};
+        }
+
+    private:
+        std::vector<T> buffer;
+    };
+
+    namespace detail
+    {
+        // Applies the NanPolicy to the final result of an algorithm. Every NaN is larger than the
+        // other values under NanPolicy::propagate, so the input contained a NaN iff the largest value
+        // is NaN. Under NanPolicy::ignore, a NaN is part of the result of the algorithms that take
+        // their values from the input (sort, max_element, ...) only if the input has fewer than two
+        // other values, and is replaced by lowest() like the values that are missing.
+        template <typename T, typename Compare>
+        constexpr TBasicResult<T, Compare> finish(TBasicResult<T, Compare> result)
+        {
+            if constexpr (std::is_floating_point_v<T> && Compare::nan_policy == NanPolicy::propagate)
+            {
+                if (result.largest != result.largest)
+                {
+                    result.second_largest = result.largest;
+                }
+            }
+            else if constexpr (std::is_floating_point_v<T> && Compare::nan_policy == NanPolicy::ignore)
+            {
+                if (result.second_largest != result.second_largest)
+                {
+                    result.second_largest = Compare::lowest();
+                }
+                if (result.largest != result.largest)
+                {
+                    result.largest = Compare::lowest();
+                }
+            }
+            return result;
+        }
+
+        // Updates the top two with one value. The branches are cheap as long as they are predicted
+        // well, i.e. if the top two rarely change.
+        template <typename T, typename Compare>
+        inline void push_branchy(TBasicResult<T, Compare> &result, T value)
+        {
+            Compare const less;
+            if (less(result.largest, value))
+            {
+                result = {result.largest, value};
+            }
+            else if (less(result.second_largest, value))
+            {
+                result.second_largest = value;
+            }
+        }
+
+        // Updates the top two with one value without data dependent branches. Both values are always
+        // written with selects, which compile to conditional moves or min/max instructions:
+        //   second_largest = max(second_largest, min(largest, value))
+        //   largest        = max(largest, value)
+        // Returns whether the top two changed.
+        template <typename T, typename Compare>
+        inline bool push_branchless(TBasicResult<T, Compare> &result, T value)
+        {
+            Compare const less;
+            auto const changed = less(result.second_largest, value);
+            auto const low = less(value, result.largest) ? value : result.largest;
+            result.second_largest = less(result.second_largest, low) ? low : result.second_largest;
+            result.largest = less(result.largest, value) ? value : result.largest;
+            return changed;
+        }
+
+        // Two independent results hide the latency of the dependent selects. The second result is
+        // merged by pushing its two values.
+        template <typename T, typename Compare>
+        TBasicResult<T, Compare> accumulate_branchless(std::span<T const> values, TBasicResult<T, Compare> init)
+        {
+            TBasicResult<T, Compare> result_0 = init, result_1;
+            size_t i = 0;
+            for (; i + 2 <= values.size(); i += 2)
+            {
+                push_branchless(result_0, values[i]);
+                push_branchless(result_1, values[i + 1]);
+            }
+            if (i < values.size())
+            {
+                push_branchless(result_0, values[i]);
+            }
+            push_branchless(result_0, result_1.second_largest);
+            push_branchless(result_0, result_1.largest);
+            return result_0;
+        }
+
+        // accumulate_adaptive reduces this many values branchless and counts how often the top two
+        // change. If they change in more than 1 / adaptive_threshold of the prefix, the branches of
+        // the branchy kernel would be mispredicted often and the rest is reduced branchless as well.
+        constexpr size_t adaptive_prefix = 1'024;
+        constexpr size_t adaptive_threshold = 32;
+    }
+
     namespace sequential
     {
-        TResult sort(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> sort_in_place(std::span<T> values)
+        {
+            std::sort(values.begin(), values.end(), Compare{});
+            return detail::finish(TBasicResult<T, Compare>{values[values.size() - 2], values[values.size() - 1]});
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> sort(std::span<T const> values)
+        {
+            auto vec = std::vector<T>(values.begin(), values.end());
+            return sort_in_place<T, Compare>(vec);
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> nth_element_in_place(std::span<T> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            std::sort(vec.begin(), vec.end());
-            return {vec[vec.size() - 2], vec[vec.size() - 1]};
+            std::nth_element(values.begin(), values.begin() + 1, values.end(),
+                             [](T lhs, T rhs) { return Compare{}(rhs, lhs); });
+            return detail::finish(TBasicResult<T, Compare>{values[1], values[0]});
         }
 
-        TResult nth_element(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> nth_element(std::span<T const> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            std::nth_element(vec.begin(), vec.begin() + 1, vec.end(),
-                             std::greater<int32_t>());
-            return {vec[1], vec[0]};
+            auto vec = std::vector<T>(values.begin(), values.end());
+            return nth_element_in_place<T, Compare>(vec);
         }
 
-        TResult max_element(std::vector<int32_t> const &values)
+        // Instead of erasing the largest element from a copy, the second largest element is searched
+        // in the ranges before and after the largest element. No copy of the data is needed.
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> max_element(std::span<T const> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            auto const largest_it = std::max_element(vec.cbegin(), vec.cend());
+            auto const largest_it = std::max_element(values.begin(), values.end(), Compare{});
 
-            TResult result;
+            TBasicResult<T, Compare> result;
             result.largest = *largest_it;
 
-            vec.erase(largest_it);
+            auto const before_it = std::max_element(values.begin(), largest_it, Compare{});
+            auto const after_it = std::max_element(std::next(largest_it), values.end(), Compare{});
 
-            result.second_largest = *std::max_element(vec.cbegin(), vec.cend());
-            return result;
+            if (before_it != largest_it)
+            {
+                result.second_largest = *before_it;
+            }
+            if (after_it != values.end() && Compare{}(result.second_largest, *after_it))
+            {
+                result.second_largest = *after_it;
+            }
+            return detail::finish(result);
         }
 
-        TResult max_element_ben_deane(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> max_element_ben_deane_in_place(std::span<T> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            auto largest_it = std::max_element(vec.begin(), vec.end());
+            auto largest_it = std::max_element(values.begin(), values.end(), Compare{});
 
-            TResult result;
+            TBasicResult<T, Compare> result;
             result.largest = *largest_it;
 
-            std::iter_swap(largest_it, std::prev(vec.end()));
+            std::iter_swap(largest_it, std::prev(values.end()));
 
-            result.second_largest = *std::max_element(vec.cbegin(), std::prev(vec.cend()));
-            return result;
+            result.second_largest = *std::max_element(values.begin(), std::prev(values.end()), Compare{});
+            return detail::finish(result);
         }
 
-        TResult accumulate(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> max_element_ben_deane(std::span<T const> values)
+        {
+            auto vec = std::vector<T>(values.begin(), values.end());
+            return max_element_ben_deane_in_place<T, Compare>(vec);
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> accumulate(std::span<T const> values)
         {
             auto const accumulate_op =
-                [](TResult const &result, int32_t value) -> TResult
+                [](TBasicResult<T, Compare> const &result, T value) -> TBasicResult<T, Compare>
             {
-                if (value > result.largest)
+                Compare const less;
+                if (less(result.largest, value))
                 {
                     return {result.largest, value};
                 }
-                else if (value > result.second_largest)
+                else if (less(result.second_largest, value))
                 {
                     return {value, result.largest};
                 }
@@ -84,95 +319,232 @@ namespace top_two
                 }
             };
 
-            return std::accumulate(values.cbegin(), values.cend(), TResult{}, accumulate_op);
+            return detail::finish(std::accumulate(values.begin(), values.end(), TBasicResult<T, Compare>{}, accumulate_op));
         }
 
-        TResult transform_reduce(std::vector<int32_t> const &values)
+        // Constant time per value, whatever the order of the input. Sorted and nearly sorted inputs
+        // change the top two with almost every value, which the branches of accumulate cannot predict.
+        // For floating-point types, the NaN handling of the comparator still needs branches.
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> accumulate_branchless(std::span<T const> values)
         {
-            auto const transform_op = [](int32_t value) -> TResult
+            return detail::finish(detail::accumulate_branchless(values, TBasicResult<T, Compare>{}));
+        }
+
+        // Picks the branchy or the branchless kernel based on a sample of the input prefix, see
+        // detail::adaptive_prefix. Shuffled inputs rarely change the top two and take the cheaper
+        // branchy kernel.
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> accumulate_adaptive(std::span<T const> values)
+        {
+            auto const prefix = values.first(std::min(values.size(), detail::adaptive_prefix));
+            auto const rest = values.subspan(prefix.size());
+
+            TBasicResult<T, Compare> result;
+            size_t n_changes = 0;
+            for (auto value : prefix)
             {
-                return {std::numeric_limits<int32_t>::min(), value};
+                n_changes += detail::push_branchless(result, value);
+            }
+
+            if (n_changes * detail::adaptive_threshold > prefix.size())
+            {
+                return detail::finish(detail::accumulate_branchless(rest, result));
+            }
+
+            for (auto value : rest)
+            {
+                detail::push_branchy(result, value);
+            }
+            return detail::finish(result);
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>>
+        TBasicResult<T, Compare> transform_reduce(std::span<T const> values)
+        {
+            auto const transform_op = [](T value) -> TBasicResult<T, Compare>
+            {
+                return {Compare::lowest(), value};
             };
 
             auto const reduce_op =
-                [](TResult const &lhs,
-                   TResult const &rhs) -> TResult
+                [](TBasicResult<T, Compare> const &lhs,
+                   TBasicResult<T, Compare> const &rhs) -> TBasicResult<T, Compare>
             {
-                if (lhs.second_largest >= rhs.largest)
+                Compare const less;
+                if (!less(lhs.second_largest, rhs.largest))
                 {
                     return lhs;
                 }
-                else if (rhs.second_largest >= lhs.largest)
+                else if (!less(rhs.second_largest, lhs.largest))
                 {
                     return rhs;
                 }
                 else
                 {
-                    return {std::min(lhs.largest, rhs.largest), std::max(lhs.largest, rhs.largest)};
+                    return {std::min(lhs.largest, rhs.largest, less), std::max(lhs.largest, rhs.largest, less)};
                 }
             };
 
-            return std::transform_reduce(values.cbegin(), values.cend(), TResult{}, reduce_op,
-                                         transform_op);
+            return detail::finish(std::transform_reduce(values.begin(), values.end(), TBasicResult<T, Compare>{}, reduce_op,
+                                                        transform_op));
         }
     }
 
+    // Backends of the parallel algorithms. A backend provides the standard algorithms that the
+    // parallel algorithms are built on. Std runs them with an execution policy of the standard
+    // library, which uses TBB with libstdc++. The other backends are in backends.h.
+    namespace backend
+    {
+        template <typename Policy = std::execution::parallel_unsequenced_policy>
+        struct Std
+        {
+            // passed as an lvalue, libstdc++ 12 does not accept a temporary policy of a dependent type
+            inline static Policy const policy{};
+
+            template <typename It, typename Compare>
+            static void sort(It first, It last, Compare compare)
+            {
+                std::sort(policy, first, last, compare);
+            }
+
+            template <typename It, typename Compare>
+            static void nth_element(It first, It nth, It last, Compare compare)
+            {
+                std::nth_element(policy, first, nth, last, compare);
+            }
+
+            template <typename It, typename Compare>
+            static It max_element(It first, It last, Compare compare)
+            {
+                return std::max_element(policy, first, last, compare);
+            }
+
+            template <typename It, typename TInit, typename Reduce>
+            static TInit reduce(It first, It last, TInit init, Reduce reduce_op)
+            {
+                return std::reduce(policy, first, last, init, reduce_op);
+            }
+
+            template <typename It, typename TInit, typename Reduce, typename Transform>
+            static TInit transform_reduce(It first, It last, TInit init, Reduce reduce_op, Transform transform_op)
+            {
+                return std::transform_reduce(policy, first, last, init, reduce_op, transform_op);
+            }
+
+            // Calls task(c) for every chunk c in [0, n_chunks), for callers that split their input
+            // into coarse chunks already, e.g. simd::reduce. Every chunk may run on a thread of its own.
+            template <typename Task>
+            static void for_chunks(size_t n_chunks, Task task)
+            {
+                std::vector<size_t> chunks(n_chunks);
+                std::iota(chunks.begin(), chunks.end(), size_t{0});
+                std::for_each(policy, chunks.cbegin(), chunks.cend(), task);
+            }
+
+            // Merges the partial results reduce_chunk(c) of the chunks c in [0, n_chunks) into init
+            template <typename TInit, typename Reduce, typename ReduceChunk>
+            static TInit reduce_chunks(size_t n_chunks, TInit init, Reduce reduce_op, ReduceChunk reduce_chunk)
+            {
+                std::vector<size_t> chunks(n_chunks);
+                std::iota(chunks.begin(), chunks.end(), size_t{0});
+                return std::transform_reduce(policy, chunks.cbegin(), chunks.cend(), init, reduce_op, reduce_chunk);
+            }
+        };
+    }
+
+    // The Backend parameter selects the threading library and, for backend::Std, the execution policy.
     namespace parallel
     {
-        TResult sort(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> sort_in_place(std::span<T> values)
+        {
+            Backend::sort(values.begin(), values.end(), Compare{});
+            return detail::finish(TBasicResult<T, Compare>{values[values.size() - 2], values[values.size() - 1]});
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> sort(std::span<T const> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            std::sort(std::execution::par_unseq, vec.begin(), vec.end());
-            return {vec[vec.size() - 2], vec[vec.size() - 1]};
+            auto vec = std::vector<T>(values.begin(), values.end());
+            return sort_in_place<T, Compare, Backend>(vec);
         }
 
-        TResult nth_element(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> nth_element_in_place(std::span<T> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            std::nth_element(std::execution::par_unseq, vec.begin(), vec.begin() + 1, vec.end(),
-                             std::greater<int32_t>());
-            return {vec[1], vec[0]};
+            Backend::nth_element(values.begin(), values.begin() + 1, values.end(),
+                                 [](T lhs, T rhs) { return Compare{}(rhs, lhs); });
+            return detail::finish(TBasicResult<T, Compare>{values[1], values[0]});
         }
 
-        TResult max_element(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> nth_element(std::span<T const> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            auto const largest_it = std::max_element(std::execution::par_unseq, vec.cbegin(), vec.cend());
+            auto vec = std::vector<T>(values.begin(), values.end());
+            return nth_element_in_place<T, Compare, Backend>(vec);
+        }
 
-            TResult result;
+        // Instead of erasing the largest element from a copy, the second largest element is searched
+        // in the ranges before and after the largest element. No copy of the data is needed.
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> max_element(std::span<T const> values)
+        {
+            auto const largest_it = Backend::max_element(values.begin(), values.end(), Compare{});
+
+            TBasicResult<T, Compare> result;
             result.largest = *largest_it;
 
-            vec.erase(largest_it);
+            auto const before_it = Backend::max_element(values.begin(), largest_it, Compare{});
+            auto const after_it = Backend::max_element(std::next(largest_it), values.end(), Compare{});
 
-            result.second_largest = *std::max_element(std::execution::par_unseq, vec.cbegin(), vec.cend());
-            return result;
+            if (before_it != largest_it)
+            {
+                result.second_largest = *before_it;
+            }
+            if (after_it != values.end() && Compare{}(result.second_largest, *after_it))
+            {
+                result.second_largest = *after_it;
+            }
+            return detail::finish(result);
         }
 
-        TResult max_element_ben_deane(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> max_element_ben_deane_in_place(std::span<T> values)
         {
-            auto vec = std::vector<int32_t>{values};
-            auto largest_it = std::max_element(std::execution::par_unseq, vec.begin(), vec.end());
+            auto largest_it = Backend::max_element(values.begin(), values.end(), Compare{});
 
-            TResult result;
+            TBasicResult<T, Compare> result;
             result.largest = *largest_it;
 
-            std::iter_swap(largest_it, std::prev(vec.end()));
+            std::iter_swap(largest_it, std::prev(values.end()));
 
-            result.second_largest = *std::max_element(std::execution::par_unseq, vec.cbegin(), std::prev(vec.cend()));
-            return result;
+            result.second_largest = *Backend::max_element(values.begin(), std::prev(values.end()), Compare{});
+            return detail::finish(result);
         }
 
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> max_element_ben_deane(std::span<T const> values)
+        {
+            auto vec = std::vector<T>(values.begin(), values.end());
+            return max_element_ben_deane_in_place<T, Compare, Backend>(vec);
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>>
         struct ReduceOp
         {
+            using TRes = TBasicResult<T, Compare>;
+
             constexpr static auto reduce_op =
-                [](int32_t value, TResult const &result) -> TResult
+                [](T value, TRes const &result) -> TRes
             {
-                if (value >= result.largest)
+                Compare const less;
+                if (!less(value, result.largest))
                 {
-                    // case 'value == result.largest' saves a comparison. it doesn't have to be checked against 'result.second_largest'. 
+                    // case 'value == result.largest' saves a comparison. it doesn't have to be checked against 'result.second_largest'.
                     return {result.largest, value};
                 }
-                else if (value > result.second_largest)
+                else if (less(result.second_largest, value))
                 {
                     return {value, result.largest};
                 }
@@ -182,65 +554,69 @@ namespace top_two
                 }
             };
 
-            TResult operator()(int32_t lhs, int32_t rhs) {
-                 return {std::min(lhs, rhs), std::max(lhs, rhs)}; }
-            TResult operator()(TResult const &result, int32_t value)
+            TRes operator()(T lhs, T rhs) const {
+                 return {std::min(lhs, rhs, Compare{}), std::max(lhs, rhs, Compare{})}; }
+            TRes operator()(TRes const &result, T value) const
             {
                 return reduce_op(value, result);
             }
-            TResult operator()(int32_t value, TResult const &result)
+            TRes operator()(T value, TRes const &result) const
             {
                 return reduce_op(value, result);
             }
-            TResult operator()(TResult const &lhs, TResult const &rhs)
+            TRes operator()(TRes const &lhs, TRes const &rhs) const
             {
-                if (lhs.second_largest >= rhs.largest)
+                Compare const less;
+                if (!less(lhs.second_largest, rhs.largest))
                 {
                     return lhs;
                 }
-                else if (rhs.second_largest >= lhs.largest)
+                else if (!less(rhs.second_largest, lhs.largest))
                 {
                     return rhs;
                 }
                 else
                 {
-                    return {std::min(lhs.largest, rhs.largest), std::max(lhs.largest, rhs.largest)};
+                    return {std::min(lhs.largest, rhs.largest, less), std::max(lhs.largest, rhs.largest, less)};
                 }
             }
         };
 
-        TResult reduce(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> reduce(std::span<T const> values)
         {
-            return std::reduce(std::execution::par_unseq, values.cbegin(), values.cend(), TResult{}, ReduceOp{});
+            return detail::finish(Backend::reduce(values.begin(), values.end(), TBasicResult<T, Compare>{}, ReduceOp<T, Compare>{}));
         }
 
-        TResult transform_reduce(std::vector<int32_t> const &values)
+        template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<>>
+        TBasicResult<T, Compare> transform_reduce(std::span<T const> values)
         {
-            auto const transform_op = [](int32_t value) -> TResult
+            auto const transform_op = [](T value) -> TBasicResult<T, Compare>
             {
-                return {std::numeric_limits<int32_t>::min(), value};
+                return {Compare::lowest(), value};
             };
 
             auto const reduce_op =
-                [](TResult const &lhs,
-                   TResult const &rhs) -> TResult
+                [](TBasicResult<T, Compare> const &lhs,
+                   TBasicResult<T, Compare> const &rhs) -> TBasicResult<T, Compare>
             {
-                if (lhs.second_largest >= rhs.largest)
+                Compare const less;
+                if (!less(lhs.second_largest, rhs.largest))
                 {
                     return lhs;
                 }
-                else if (rhs.second_largest >= lhs.largest)
+                else if (!less(rhs.second_largest, lhs.largest))
                 {
                     return rhs;
                 }
                 else
                 {
-                    return {std::min(lhs.largest, rhs.largest), std::max(lhs.largest, rhs.largest)};
+                    return {std::min(lhs.largest, rhs.largest, less), std::max(lhs.largest, rhs.largest, less)};
                 }
             };
 
-            return std::transform_reduce(std::execution::par_unseq, values.cbegin(), values.cend(), TResult{}, reduce_op,
-                                         transform_op);
+            return detail::finish(Backend::transform_reduce(values.begin(), values.end(), TBasicResult<T, Compare>{}, reduce_op,
+                                                            transform_op));
         }
     }
 }
\ No newline at end of file
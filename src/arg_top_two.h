@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "algorithms.h"
+
+namespace top_two
+{
+    // Positions of the largest and the second largest element. The values are kept alongside the
+    // indices because partial results are merged by value.
+    //
+    // Ties are broken by position: of two equal values, the one with the smaller index ranks higher.
+    // Values and positions together define a total order, so the result is the same for every order
+    // in which partial results are merged.
+    template <typename T, typename Compare = Less<T>>
+    struct TBasicArgResult
+    {
+        using value_type = T;
+        using compare_type = Compare;
+
+        constexpr static size_t npos = std::numeric_limits<size_t>::max();
+
+        size_t second_largest = npos;
+        size_t largest = npos;
+        T second_largest_value = Compare::lowest();
+        T largest_value = Compare::lowest();
+
+        bool operator==(const TBasicArgResult &other) const
+        {
+            return (second_largest == other.second_largest && largest == other.largest);
+        }
+
+        TBasicArgResult() = default;
+        TBasicArgResult(size_t second_largest_, T second_largest_value_, size_t largest_, T largest_value_)
+            : second_largest(second_largest_), largest(largest_), second_largest_value(second_largest_value_), largest_value(largest_value_) {}
+    };
+
+    using TArgResult = TBasicArgResult<int32_t>;
+
+    namespace arg_top_two
+    {
+        // Default projection, used for a plain column of keys (structure of arrays).
+        struct Identity
+        {
+            template <typename U>
+            constexpr U const &operator()(U const &value) const
+            {
+                return value;
+            }
+        };
+
+        template <typename Record, typename Projection>
+        using key_t = std::decay_t<std::invoke_result_t<Projection const &, Record const &>>;
+
+        namespace detail
+        {
+            template <typename T, typename Compare>
+            bool ranks_before(T lhs_value, size_t lhs_index, T rhs_value, size_t rhs_index)
+            {
+                Compare const less;
+                return less(rhs_value, lhs_value) || (!less(lhs_value, rhs_value) && lhs_index < rhs_index);
+            }
+
+            // Elements per task of the parallel reduction
+            constexpr size_t chunk_size = 1 << 16;
+        }
+
+        template <typename T, typename Compare = Less<T>>
+        struct ReduceOp
+        {
+            using TRes = TBasicArgResult<T, Compare>;
+
+            TRes operator()(TRes const &result, T value, size_t index) const
+            {
+                if (detail::ranks_before<T, Compare>(value, index, result.largest_value, result.largest))
+                {
+                    return {result.largest, result.largest_value, index, value};
+                }
+                else if (detail::ranks_before<T, Compare>(value, index, result.second_largest_value, result.second_largest))
+                {
+                    return {index, value, result.largest, result.largest_value};
+                }
+                else
+                {
+                    return result;
+                }
+            }
+
+            TRes operator()(TRes const &lhs, TRes const &rhs) const
+            {
+                if (detail::ranks_before<T, Compare>(lhs.second_largest_value, lhs.second_largest, rhs.largest_value, rhs.largest))
+                {
+                    return lhs;
+                }
+                else if (detail::ranks_before<T, Compare>(rhs.second_largest_value, rhs.second_largest, lhs.largest_value, lhs.largest))
+                {
+                    return rhs;
+                }
+                else if (detail::ranks_before<T, Compare>(lhs.largest_value, lhs.largest, rhs.largest_value, rhs.largest))
+                {
+                    return {rhs.largest, rhs.largest_value, lhs.largest, lhs.largest_value};
+                }
+                else
+                {
+                    return {lhs.largest, lhs.largest_value, rhs.largest, rhs.largest_value};
+                }
+            }
+        };
+
+        namespace sequential
+        {
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> accumulate(std::span<Record const> records, Projection projection = {})
+            {
+                using T = key_t<Record, Projection>;
+
+                size_t index = 0;
+                auto const accumulate_op =
+                    [&index, &projection](TBasicArgResult<T, Compare> const &result, Record const &record) -> TBasicArgResult<T, Compare>
+                {
+                    return ReduceOp<T, Compare>{}(result, std::invoke(projection, record), index++);
+                };
+
+                return std::accumulate(records.begin(), records.end(), TBasicArgResult<T, Compare>{}, accumulate_op);
+            }
+
+            // The index of a record is recovered from its address, which is valid because the transform
+            // receives references into the contiguous storage of the span.
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> transform_reduce(std::span<Record const> records, Projection projection = {})
+            {
+                using T = key_t<Record, Projection>;
+
+                auto const transform_op = [first = records.data(), &projection](Record const &record) -> TBasicArgResult<T, Compare>
+                {
+                    return ReduceOp<T, Compare>{}(TBasicArgResult<T, Compare>{}, std::invoke(projection, record), static_cast<size_t>(&record - first));
+                };
+
+                return std::transform_reduce(records.begin(), records.end(), TBasicArgResult<T, Compare>{}, ReduceOp<T, Compare>{},
+                                             transform_op);
+            }
+
+            // The std::vector overloads deduce Record from the argument
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> accumulate(std::vector<Record> const &records, Projection projection = {})
+            {
+                return accumulate<Record, Projection, Compare>(std::span<Record const>(records), projection);
+            }
+
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> transform_reduce(std::vector<Record> const &records, Projection projection = {})
+            {
+                return transform_reduce<Record, Projection, Compare>(std::span<Record const>(records), projection);
+            }
+        }
+
+        namespace parallel
+        {
+            // Chunks of consecutive records are accumulated in parallel on the Backend and merged with
+            // ReduceOp.
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>, typename Backend = backend::Std<>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> reduce(std::span<Record const> records, Projection projection = {})
+            {
+                using T = key_t<Record, Projection>;
+
+                auto const n_chunks = (records.size() + detail::chunk_size - 1) / detail::chunk_size;
+
+                auto const reduce_chunk = [records, &projection](size_t chunk) -> TBasicArgResult<T, Compare>
+                {
+                    TBasicArgResult<T, Compare> result;
+                    auto const last = std::min(records.size(), (chunk + 1) * detail::chunk_size);
+                    for (auto index = chunk * detail::chunk_size; index < last; ++index)
+                    {
+                        result = ReduceOp<T, Compare>{}(result, std::invoke(projection, records[index]), index);
+                    }
+                    return result;
+                };
+
+                return Backend::reduce_chunks(n_chunks, TBasicArgResult<T, Compare>{}, ReduceOp<T, Compare>{}, reduce_chunk);
+            }
+
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>, typename Backend = backend::Std<>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> transform_reduce(std::span<Record const> records, Projection projection = {})
+            {
+                using T = key_t<Record, Projection>;
+
+                auto const transform_op = [first = records.data(), &projection](Record const &record) -> TBasicArgResult<T, Compare>
+                {
+                    return ReduceOp<T, Compare>{}(TBasicArgResult<T, Compare>{}, std::invoke(projection, record), static_cast<size_t>(&record - first));
+                };
+
+                return Backend::transform_reduce(records.begin(), records.end(), TBasicArgResult<T, Compare>{}, ReduceOp<T, Compare>{}, transform_op);
+            }
+
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>, typename Backend = backend::Std<>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> reduce(std::vector<Record> const &records, Projection projection = {})
+            {
+                return reduce<Record, Projection, Compare, Backend>(std::span<Record const>(records), projection);
+            }
+
+            template <typename Record, typename Projection = Identity, typename Compare = Less<key_t<Record, Projection>>, typename Backend = backend::Std<>>
+            TBasicArgResult<key_t<Record, Projection>, Compare> transform_reduce(std::vector<Record> const &records, Projection projection = {})
+            {
+                return transform_reduce<Record, Projection, Compare, Backend>(std::span<Record const>(records), projection);
+            }
+        }
+    }
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#include <parallel/algorithm>
+#include <parallel/numeric>
+#endif
+
+#if __has_include(<tbb/global_control.h>)
+#include <tbb/global_control.h>
+#define TOP_TWO_HAS_TBB 1
+#endif
+
+#include "algorithms.h"
+#include "thread_pool.h"
+
+namespace top_two
+{
+    // Backends for the Backend parameter of the parallel algorithms in addition to backend::Std:
+    //   Threads  std::thread workers of a TThreadPool
+    //   OpenMP   parallel loops of OpenMP
+    //   Gnu      the parallel mode of libstdc++, which runs on OpenMP
+    // OpenMP and Gnu exist if the code is compiled with -fopenmp.
+    //
+    // Threads and OpenMP split the input into one chunk per thread. sort sorts the chunks and merges
+    // neighbouring chunks in rounds, nth_element selects the candidates of every chunk and then
+    // selects among the candidates, and the reductions merge one partial result per chunk.
+    // for_chunks and reduce_chunks take chunks that the caller has formed already and run one task
+    // per chunk, however few chunks there are.
+    namespace backend
+    {
+        using ParUnseq = Std<std::execution::parallel_unsequenced_policy>;
+        using Par = Std<std::execution::parallel_policy>;
+        using Unseq = Std<std::execution::unsequenced_policy>;
+
+        namespace detail
+        {
+            // Chunks are not smaller than this, so small inputs use fewer threads
+            constexpr size_t min_chunk_size = size_t{1} << 14;
+
+            inline size_t n_chunks(size_t size, size_t n_threads)
+            {
+                return std::clamp<size_t>(size / min_chunk_size, 1, std::max<size_t>(n_threads, 1));
+            }
+
+            // Pool of the Threads backend, replaced by set_n_threads
+            inline std::unique_ptr<TThreadPool> &threads_pool()
+            {
+                static std::unique_ptr<TThreadPool> pool = std::make_unique<TThreadPool>();
+                return pool;
+            }
+
+            struct TThreadsFor
+            {
+                static size_t n_threads() { return threads_pool()->size(); }
+
+                // Calls task(i) for i in [0, n_tasks), every worker takes a contiguous range of tasks
+                template <typename Task>
+                static void run(size_t n_tasks, Task task)
+                {
+                    threads_pool()->for_each_block(n_tasks, [&task](size_t first, size_t last)
+                                                   {
+                                                       for (auto i = first; i < last; ++i)
+                                                       {
+                                                           task(i);
+                                                       }
+                                                   },
+                                                   1);
+                }
+            };
+
+#ifdef _OPENMP
+            struct TOpenMPFor
+            {
+                static size_t n_threads() { return static_cast<size_t>(omp_get_max_threads()); }
+
+                template <typename Task>
+                static void run(size_t n_tasks, Task task)
+                {
+#pragma omp parallel for schedule(static)
+                    for (size_t i = 0; i < n_tasks; ++i)
+                    {
+                        task(i);
+                    }
+                }
+            };
+#endif
+
+            // The algorithms of a backend on top of a parallel loop For
+            template <typename For>
+            struct Chunked
+            {
+                template <typename It, typename Compare>
+                static void sort(It first, It last, Compare compare)
+                {
+                    auto const size = static_cast<size_t>(last - first);
+                    auto const k = n_chunks(size, For::n_threads());
+                    auto const chunk = [first, size, k](size_t c) { return first + size * c / k; };
+
+                    For::run(k, [&](size_t c) { std::sort(chunk(c), chunk(c + 1), compare); });
+                    // every round merges pairs of neighbouring sorted runs and halves the number of runs
+                    for (size_t width = 1; width < k; width *= 2)
+                    {
+                        For::run((k + 2 * width - 1) / (2 * width), [&](size_t pair)
+                                 {
+                                     auto const low = 2 * width * pair;
+                                     auto const middle = std::min(low + width, k);
+                                     auto const high = std::min(low + 2 * width, k);
+                                     std::inplace_merge(chunk(low), chunk(middle), chunk(high), compare);
+                                 });
+                    }
+                }
+
+                // The n elements up to nth of the whole range are among the first n elements of the
+                // chunks after selecting in every chunk. These candidates are swapped to the front of
+                // the first chunk, behind its own candidates, and selected once more. Every element
+                // outside of the candidates is not less than the n-th element of its chunk, and thus
+                // not less than the n-th element of the range. If the candidates do not fit into the
+                // first chunk, the selection is sequential.
+                template <typename It, typename Compare>
+                static void nth_element(It first, It nth, It last, Compare compare)
+                {
+                    auto const size = static_cast<size_t>(last - first);
+                    auto const n = static_cast<size_t>(nth - first) + 1;
+                    auto const k = n_chunks(size, For::n_threads());
+                    if (nth == last || k == 1 || n * k > size / k)
+                    {
+                        std::nth_element(first, nth, last, compare);
+                        return;
+                    }
+
+                    auto const chunk = [first, size, k](size_t c) { return first + size * c / k; };
+                    For::run(k, [&](size_t c) { std::nth_element(chunk(c), chunk(c) + (n - 1), chunk(c + 1), compare); });
+                    for (size_t c = 1; c < k; ++c)
+                    {
+                        std::swap_ranges(chunk(c), chunk(c) + n, first + c * n);
+                    }
+                    std::nth_element(first, nth, first + k * n, compare);
+                }
+
+                template <typename It, typename Compare>
+                static It max_element(It first, It last, Compare compare)
+                {
+                    auto const size = static_cast<size_t>(last - first);
+                    auto const k = n_chunks(size, For::n_threads());
+                    auto const chunk = [first, size, k](size_t c) { return first + size * c / k; };
+
+                    // the largest element of every chunk, the first one wins ties
+                    std::vector<It> largest(k);
+                    For::run(k, [&](size_t c) { largest[c] = std::max_element(chunk(c), chunk(c + 1), compare); });
+                    auto result = largest[0];
+                    for (size_t c = 1; c < k; ++c)
+                    {
+                        if (compare(*result, *largest[c]))
+                        {
+                            result = largest[c];
+                        }
+                    }
+                    return result;
+                }
+
+                // The partial result of a chunk starts with its first two elements, so init is used once
+                template <typename It, typename TInit, typename Reduce>
+                static TInit reduce(It first, It last, TInit init, Reduce reduce_op)
+                {
+                    auto const size = static_cast<size_t>(last - first);
+                    auto const k = n_chunks(size, For::n_threads());
+                    if (k == 1)
+                    {
+                        return std::accumulate(first, last, init, reduce_op);
+                    }
+
+                    auto const chunk = [first, size, k](size_t c) { return first + size * c / k; };
+                    std::vector<TInit> partials(k, init);
+                    For::run(k, [&](size_t c)
+                             {
+                                 auto const begin = chunk(c);
+                                 partials[c] = std::accumulate(begin + 2, chunk(c + 1), TInit(reduce_op(begin[0], begin[1])), reduce_op);
+                             });
+                    return std::accumulate(partials.cbegin(), partials.cend(), init, reduce_op);
+                }
+
+                template <typename It, typename TInit, typename Reduce, typename Transform>
+                static TInit transform_reduce(It first, It last, TInit init, Reduce reduce_op, Transform transform_op)
+                {
+                    auto const size = static_cast<size_t>(last - first);
+                    auto const k = n_chunks(size, For::n_threads());
+                    if (k == 1)
+                    {
+                        return std::transform_reduce(first, last, init, reduce_op, transform_op);
+                    }
+
+                    auto const chunk = [first, size, k](size_t c) { return first + size * c / k; };
+                    std::vector<TInit> partials(k, init);
+                    For::run(k, [&](size_t c)
+                             {
+                                 auto const begin = chunk(c);
+                                 partials[c] = std::transform_reduce(begin + 1, chunk(c + 1), TInit(transform_op(*begin)), reduce_op, transform_op);
+                             });
+                    return std::accumulate(partials.cbegin(), partials.cend(), init, reduce_op);
+                }
+
+                template <typename Task>
+                static void for_chunks(size_t n_chunks, Task task)
+                {
+                    For::run(n_chunks, task);
+                }
+
+                template <typename TInit, typename Reduce, typename ReduceChunk>
+                static TInit reduce_chunks(size_t n_chunks, TInit init, Reduce reduce_op, ReduceChunk reduce_chunk)
+                {
+                    std::vector<TInit> partials(n_chunks, init);
+                    For::run(n_chunks, [&](size_t c) { partials[c] = reduce_chunk(c); });
+                    return std::accumulate(partials.cbegin(), partials.cend(), init, reduce_op);
+                }
+            };
+
+#ifdef _OPENMP
+            // Random access iterator over transform_op(*it) for __gnu_parallel::accumulate. It starts
+            // the partial result of every thread with a copy of the thread's first element, so the
+            // elements have to be partial results already.
+            template <typename It, typename TInit, typename Transform>
+            class TTransformIterator
+            {
+            public:
+                using iterator_category = std::random_access_iterator_tag;
+                using value_type = TInit;
+                using difference_type = std::ptrdiff_t;
+                using pointer = void;
+                using reference = TInit;
+
+                TTransformIterator() = default;
+                TTransformIterator(It it_, Transform const *transform_op_) : it(it_), transform_op(transform_op_) {}
+
+                TInit operator*() const { return (*transform_op)(*it); }
+                TInit operator[](difference_type n) const { return (*transform_op)(it[n]); }
+
+                TTransformIterator &operator++() { ++it; return *this; }
+                TTransformIterator &operator+=(difference_type n) { it += n; return *this; }
+                TTransformIterator operator+(difference_type n) const { return {it + n, transform_op}; }
+                difference_type operator-(TTransformIterator const &other) const { return it - other.it; }
+                bool operator==(TTransformIterator const &other) const { return it == other.it; }
+                bool operator<(TTransformIterator const &other) const { return it < other.it; }
+
+            private:
+                It it{};
+                Transform const *transform_op = nullptr;
+            };
+
+            template <typename TInit, typename It, typename Transform, typename Reduce>
+            TInit gnu_transform_reduce(It first, It last, TInit init, Reduce reduce_op, Transform const &transform_op)
+            {
+                return __gnu_parallel::accumulate(TTransformIterator<It, TInit, Transform>(first, &transform_op),
+                                                  TTransformIterator<It, TInit, Transform>(last, &transform_op), init, reduce_op);
+            }
+#endif
+        }
+
+        using Threads = detail::Chunked<detail::TThreadsFor>;
+
+#ifdef _OPENMP
+        using OpenMP = detail::Chunked<detail::TOpenMPFor>;
+
+        struct Gnu
+        {
+            template <typename It, typename Compare>
+            static void sort(It first, It last, Compare compare)
+            {
+                __gnu_parallel::sort(first, last, compare);
+            }
+
+            template <typename It, typename Compare>
+            static void nth_element(It first, It nth, It last, Compare compare)
+            {
+                __gnu_parallel::nth_element(first, nth, last, compare);
+            }
+
+            template <typename It, typename Compare>
+            static It max_element(It first, It last, Compare compare)
+            {
+                return __gnu_parallel::max_element(first, last, compare);
+            }
+
+            // Every value is turned into the partial result of itself, i.e. folded into a default
+            // constructed TInit, which is the neutral element of reduce_op
+            template <typename It, typename TInit, typename Reduce>
+            static TInit reduce(It first, It last, TInit init, Reduce reduce_op)
+            {
+                auto const transform_op = [reduce_op](auto const &value) { return reduce_op(TInit{}, value); };
+                return detail::gnu_transform_reduce(first, last, init, reduce_op, transform_op);
+            }
+
+            template <typename It, typename TInit, typename Reduce, typename Transform>
+            static TInit transform_reduce(It first, It last, TInit init, Reduce reduce_op, Transform transform_op)
+            {
+                return detail::gnu_transform_reduce(first, last, init, reduce_op, transform_op);
+            }
+
+            // The parallel mode runs ranges below its thresholds sequentially, e.g. for_each and
+            // accumulate below 1'000 elements, which the chunks of an input hardly reach. The chunks
+            // run on the OpenMP loop that the parallel mode is built on instead.
+            template <typename Task>
+            static void for_chunks(size_t n_chunks, Task task)
+            {
+                OpenMP::for_chunks(n_chunks, task);
+            }
+
+            template <typename TInit, typename Reduce, typename ReduceChunk>
+            static TInit reduce_chunks(size_t n_chunks, TInit init, Reduce reduce_op, ReduceChunk reduce_chunk)
+            {
+                return OpenMP::reduce_chunks(n_chunks, init, reduce_op, reduce_chunk);
+            }
+        };
+#endif
+
+        // Limits every backend to n_threads threads, 0 restores the default of one thread per
+        // hardware thread. Not thread-safe, meant for benchmark drivers between measurements.
+        inline void set_n_threads(size_t n_threads)
+        {
+            detail::threads_pool() = std::make_unique<TThreadPool>(TPoolConfig{n_threads});
+#ifdef _OPENMP
+            omp_set_num_threads(n_threads == 0 ? omp_get_num_procs() : static_cast<int>(n_threads));
+#endif
+#ifdef TOP_TWO_HAS_TBB
+            static std::unique_ptr<tbb::global_control> control;
+            control.reset();
+            if (n_threads != 0)
+            {
+                control = std::make_unique<tbb::global_control>(tbb::global_control::max_allowed_parallelism, n_threads);
+            }
+#endif
+        }
+    }
+}
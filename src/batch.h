@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "algorithms.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace top_two
+{
+    // Top two of many independent vectors that are stored back to back in one flat buffer. Vector i
+    // consists of values[offsets[i]] .. values[offsets[i + 1] - 1], so offsets has one more entry than
+    // there are vectors. An empty vector yields TBasicResult<T>{}.
+    namespace batch
+    {
+        namespace detail
+        {
+            // Short vectors are transposed onto the lanes of one vector register: lane j reduces vector
+            // first_vector + j, and step i loads element i of every vector. Lanes of exhausted vectors
+            // are filled with the lowest value. This keeps all lanes busy for vectors that are too short
+            // for the contiguous kernel and needs no branches on the data. Vectors that fill at least one
+            // iteration of the contiguous kernel are reduced on their own by that kernel.
+            template <typename T, size_t NBytes>
+            __attribute__((always_inline)) inline void accumulate_group(T const *values, std::span<size_t const> offsets, size_t first_vector,
+                                                                        simd::detail::TKernel<T> kernel, TBasicResult<T> *results)
+            {
+                typedef T TVector __attribute__((vector_size(NBytes)));
+                constexpr size_t n_lanes = NBytes / sizeof(T);
+                constexpr size_t long_vector = 2 * n_lanes;
+                auto const n_vectors = offsets.size() - 1;
+                auto const lowest_value = Less<T>::lowest();
+
+                std::array<size_t, n_lanes> first{}, length{};
+                size_t max_length = 0;
+                for (size_t lane = 0; lane < n_lanes && first_vector + lane < n_vectors; ++lane)
+                {
+                    auto const vector = first_vector + lane;
+                    first[lane] = offsets[vector];
+                    length[lane] = offsets[vector + 1] - offsets[vector];
+                    if (length[lane] >= long_vector)
+                    {
+                        results[vector] = kernel(values + first[lane], values + first[lane] + length[lane]);
+                        length[lane] = 0;
+                        continue;
+                    }
+                    max_length = std::max(max_length, length[lane]);
+                }
+
+                auto const lowest = TVector{} + lowest_value;
+                TVector largest = lowest, second_largest = lowest;
+                for (size_t i = 0; i < max_length; ++i)
+                {
+                    TVector v;
+                    for (size_t lane = 0; lane < n_lanes; ++lane)
+                    {
+                        v[lane] = i < length[lane] ? values[first[lane] + i] : lowest_value;
+                    }
+                    auto const low = v < largest ? v : largest;
+                    second_largest = second_largest < low ? low : second_largest;
+                    largest = largest < v ? v : largest;
+                }
+
+                for (size_t lane = 0; lane < n_lanes && first_vector + lane < n_vectors; ++lane)
+                {
+                    if (offsets[first_vector + lane + 1] - offsets[first_vector + lane] < long_vector)
+                    {
+                        results[first_vector + lane] = {second_largest[lane], largest[lane]};
+                    }
+                }
+            }
+
+            template <typename T, size_t NBytes>
+            __attribute__((always_inline)) inline void accumulate_groups(std::span<T const> values, std::span<size_t const> offsets, size_t first_group, size_t last_group,
+                                                                         simd::detail::TKernel<T> kernel, std::span<TBasicResult<T>> results)
+            {
+                constexpr size_t n_lanes = NBytes / sizeof(T);
+                for (auto group = first_group; group < last_group; ++group)
+                {
+                    accumulate_group<T, NBytes>(values.data(), offsets, group * n_lanes, kernel, results.data());
+                }
+            }
+
+#ifdef TOP_TWO_SIMD_X86
+            template <typename T>
+            __attribute__((target("sse4.1")))
+            void accumulate_groups_sse41(std::span<T const> values, std::span<size_t const> offsets, size_t first_group, size_t last_group,
+                                         simd::detail::TKernel<T> kernel, std::span<TBasicResult<T>> results)
+            {
+                accumulate_groups<T, 16>(values, offsets, first_group, last_group, kernel, results);
+            }
+
+            template <typename T>
+            __attribute__((target("avx2")))
+            void accumulate_groups_avx2(std::span<T const> values, std::span<size_t const> offsets, size_t first_group, size_t last_group,
+                                        simd::detail::TKernel<T> kernel, std::span<TBasicResult<T>> results)
+            {
+                accumulate_groups<T, 32>(values, offsets, first_group, last_group, kernel, results);
+            }
+
+            template <typename T>
+            __attribute__((target("avx512f,avx512bw")))
+            void accumulate_groups_avx512(std::span<T const> values, std::span<size_t const> offsets, size_t first_group, size_t last_group,
+                                          simd::detail::TKernel<T> kernel, std::span<TBasicResult<T>> results)
+            {
+                accumulate_groups<T, 64>(values, offsets, first_group, last_group, kernel, results);
+            }
+#endif
+
+            // Vectors per lane group of the given ISA, 1 for the scalar path
+            template <typename T>
+            size_t n_lanes(simd::Isa isa)
+            {
+                if constexpr (std::is_integral_v<T>)
+                {
+                    switch (isa)
+                    {
+#ifdef TOP_TWO_SIMD_X86
+                    case simd::Isa::sse41:
+                        return 16 / sizeof(T);
+                    case simd::Isa::avx2:
+                        return 32 / sizeof(T);
+                    case simd::Isa::avx512:
+                        return 64 / sizeof(T);
+#endif
+                    default:
+                        break;
+                    }
+                }
+                return 1;
+            }
+
+            // Reduces the vectors of the lane groups [first_group, last_group)
+            template <typename T>
+            void accumulate(std::span<T const> values, std::span<size_t const> offsets, size_t first_group, size_t last_group,
+                            simd::Isa isa, std::span<TBasicResult<T>> results)
+            {
+                auto const kernel = simd::detail::kernel<T>(isa);
+                if constexpr (std::is_integral_v<T>)
+                {
+                    switch (isa)
+                    {
+#ifdef TOP_TWO_SIMD_X86
+                    case simd::Isa::sse41:
+                        return accumulate_groups_sse41<T>(values, offsets, first_group, last_group, kernel, results);
+                    case simd::Isa::avx2:
+                        return accumulate_groups_avx2<T>(values, offsets, first_group, last_group, kernel, results);
+                    case simd::Isa::avx512:
+                        return accumulate_groups_avx512<T>(values, offsets, first_group, last_group, kernel, results);
+#endif
+                    default:
+                        break;
+                    }
+                }
+                for (auto vector = first_group; vector < last_group; ++vector)
+                {
+                    results[vector] = kernel(values.data() + offsets[vector], values.data() + offsets[vector + 1]);
+                }
+            }
+
+            template <typename T>
+            size_t n_groups(std::span<size_t const> offsets, simd::Isa isa)
+            {
+                auto const n_vectors = offsets.empty() ? 0 : offsets.size() - 1;
+                return (n_vectors + n_lanes<T>(isa) - 1) / n_lanes<T>(isa);
+            }
+
+            template <typename T>
+            void check_results(std::span<size_t const> offsets, std::span<TBasicResult<T>> results)
+            {
+                auto const n_vectors = offsets.empty() ? 0 : offsets.size() - 1;
+                if (results.size() != n_vectors)
+                {
+                    throw std::invalid_argument("batch: " + std::to_string(n_vectors) + " vectors but " + std::to_string(results.size()) + " results");
+                }
+            }
+        }
+
+        namespace sequential
+        {
+            // results must hold one entry per vector
+            template <typename T = int32_t>
+            void accumulate(std::span<T const> values, std::span<size_t const> offsets, std::span<TBasicResult<T>> results, simd::Isa isa = simd::best_isa())
+            {
+                detail::check_results(offsets, results);
+                detail::accumulate(values, offsets, 0, detail::n_groups<T>(offsets, isa), isa, results);
+            }
+
+            template <typename T = int32_t>
+            std::vector<TBasicResult<T>> accumulate(std::span<T const> values, std::span<size_t const> offsets)
+            {
+                std::vector<TBasicResult<T>> results(offsets.empty() ? 0 : offsets.size() - 1);
+                accumulate<T>(values, offsets, std::span<TBasicResult<T>>{results});
+                return results;
+            }
+        }
+
+        namespace parallel
+        {
+            // Lane groups are distributed over the threads of the pool in blocks of grain_size groups.
+            template <typename T = int32_t>
+            void reduce(std::span<T const> values, std::span<size_t const> offsets, std::span<TBasicResult<T>> results,
+                        TThreadPool &pool = default_pool(), size_t grain_size = 64, simd::Isa isa = simd::best_isa())
+            {
+                detail::check_results(offsets, results);
+                pool.for_each_block(detail::n_groups<T>(offsets, isa),
+                                    [&](size_t first_group, size_t last_group)
+                                    { detail::accumulate(values, offsets, first_group, last_group, isa, results); },
+                                    grain_size);
+            }
+
+            template <typename T = int32_t>
+            std::vector<TBasicResult<T>> reduce(std::span<T const> values, std::span<size_t const> offsets, TThreadPool &pool = default_pool())
+            {
+                std::vector<TBasicResult<T>> results(offsets.empty() ? 0 : offsets.size() - 1);
+                reduce<T>(values, offsets, std::span<TBasicResult<T>>{results}, pool);
+                return results;
+            }
+        }
+    }
+}
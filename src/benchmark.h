@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+namespace top_two
+{
+    constexpr static auto duration_in_ms = [](auto start, auto end) -> double
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    using TDataset = std::vector<std::vector<int32_t>>;
+
+    inline auto make_dataset(size_t size, size_t n_permutations)
+    {
+        std::vector<int32_t> data(size);
+        std::iota(data.begin(), data.end(), 0);
+        TDataset dataset;
+        dataset.reserve(n_permutations);
+
+        std::mt19937 rng(19937);
+
+        for (size_t i = 0; i < n_permutations; ++i)
+        {
+            std::shuffle(data.begin(), data.end(), rng);
+            dataset.push_back(data);
+        }
+
+        return dataset;
+    }
+
+    // Measurement harness shared by the benchmark drivers
+    namespace benchmark
+    {
+        enum class CacheMode
+        {
+            warm, // the data of a call may still be cached from the previous call
+            cold  // the caches are flushed before every call
+        };
+
+        struct TConfig
+        {
+            size_t n_warmup = 1;
+            size_t n_trials = 10;
+            size_t n_permutations = 1'000; // shuffled inputs per size of the drivers that measure permutations
+            CacheMode cache_mode = CacheMode::warm;
+            size_t flush_size = size_t{256} << 20; // bytes written to evict the caches, larger than the last level cache
+            bool counters = false;                 // record hardware performance counters during the trials
+        };
+
+        // Options: --warmup N, --trials N, --permutations N, --cold, --flush-size BYTES, --counters
+        inline TConfig parse_config(int argc, char **argv)
+        {
+            TConfig config;
+            for (int i = 1; i < argc; ++i)
+            {
+                auto const has_value = i + 1 < argc;
+                if (std::strcmp(argv[i], "--cold") == 0)
+                {
+                    config.cache_mode = CacheMode::cold;
+                }
+                else if (std::strcmp(argv[i], "--counters") == 0)
+                {
+                    config.counters = true;
+                }
+                else if (std::strcmp(argv[i], "--warmup") == 0 && has_value)
+                {
+                    config.n_warmup = std::stoul(argv[++i]);
+                }
+                else if (std::strcmp(argv[i], "--trials") == 0 && has_value)
+                {
+                    config.n_trials = std::max<size_t>(1, std::stoul(argv[++i]));
+                }
+                else if (std::strcmp(argv[i], "--permutations") == 0 && has_value)
+                {
+                    config.n_permutations = std::max<size_t>(1, std::stoul(argv[++i]));
+                }
+                else if (std::strcmp(argv[i], "--flush-size") == 0 && has_value)
+                {
+                    config.flush_size = std::stoul(argv[++i]);
+                }
+            }
+            return config;
+        }
+
+        inline char const *to_string(CacheMode cache_mode)
+        {
+            return cache_mode == CacheMode::cold ? "cold" : "warm";
+        }
+
+        struct TStatistics
+        {
+            size_t n_trials = 0;
+            double median = NAN;
+            double mad = NAN;      // median absolute deviation from the median
+            double ci_low = NAN;   // distribution-free 95% confidence interval of the median
+            double ci_high = NAN;
+            double mean = NAN;
+            double min = NAN;
+            double max = NAN;
+            double bandwidth = NAN; // input bytes per second of the median call, in GB/s
+            TCounterValues counters; // per call, averaged over all trials
+        };
+
+        inline TStatistics summarize(std::vector<double> samples)
+        {
+            TStatistics statistics;
+            statistics.n_trials = samples.size();
+            if (samples.empty())
+            {
+                return statistics;
+            }
+
+            auto const median_of_sorted = [](std::vector<double> const &sorted)
+            {
+                auto const n = sorted.size();
+                return n % 2 == 1 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+            };
+
+            std::sort(samples.begin(), samples.end());
+            auto const n = samples.size();
+            statistics.median = median_of_sorted(samples);
+            statistics.mean = std::accumulate(samples.cbegin(), samples.cend(), 0.0) / n;
+            statistics.min = samples.front();
+            statistics.max = samples.back();
+
+            std::vector<double> deviations(n);
+            std::transform(samples.cbegin(), samples.cend(), deviations.begin(),
+                           [&statistics](double sample) { return std::abs(sample - statistics.median); });
+            std::sort(deviations.begin(), deviations.end());
+            statistics.mad = median_of_sorted(deviations);
+
+            // order statistics j and k (1-based) that enclose the median with 95% probability
+            auto const half_width = 1.96 * std::sqrt(static_cast<double>(n)) / 2.0;
+            auto const j = static_cast<long>(std::floor(n / 2.0 - half_width));
+            auto const k = static_cast<long>(std::ceil(1.0 + n / 2.0 + half_width));
+            statistics.ci_low = samples[std::clamp<long>(j - 1, 0, n - 1)];
+            statistics.ci_high = samples[std::clamp<long>(k - 1, 0, n - 1)];
+            return statistics;
+        }
+
+        // Evicts the caches by writing a buffer that is larger than the last level cache
+        class TCacheFlusher
+        {
+        public:
+            explicit TCacheFlusher(size_t size) : buffer(size) {}
+
+            void flush()
+            {
+                char sum = 0;
+                for (size_t i = 0; i < buffer.size(); i += 64)
+                {
+                    sum = static_cast<char>(sum + ++buffer[i]);
+                }
+                sink = sum;
+            }
+
+        private:
+            std::vector<char> buffer;
+            char volatile sink = 0;
+        };
+
+        // The flusher for a flush size, allocated on first use and shared by all measurements with
+        // that size
+        inline TCacheFlusher &cache_flusher(size_t flush_size)
+        {
+            static std::map<size_t, TCacheFlusher> flushers;
+            return flushers.try_emplace(flush_size, flush_size).first->second;
+        }
+
+        // Calls setup() and then run() n_warmup + n_trials times and returns the durations of run()
+        // in ms for the trials. setup() is not timed. If counters are given, they are reset and then
+        // count run() of the trials only.
+        template <typename Setup, typename Run>
+        std::vector<double> sample(Setup setup, Run run, size_t n_warmup, size_t n_trials, TPerfCounters *counters = nullptr)
+        {
+            std::vector<double> samples;
+            samples.reserve(n_trials);
+            if (counters)
+            {
+                counters->reset();
+            }
+            for (size_t trial = 0; trial < n_warmup + n_trials; ++trial)
+            {
+                auto const counted = counters && trial >= n_warmup;
+                setup();
+                if (counted)
+                {
+                    counters->enable();
+                }
+                auto const start = std::chrono::high_resolution_clock::now();
+                run();
+                auto const end = std::chrono::high_resolution_clock::now();
+                if (counted)
+                {
+                    counters->disable();
+                }
+                if (trial >= n_warmup)
+                {
+                    samples.push_back(duration_in_ms(start, end));
+                }
+            }
+            return samples;
+        }
+
+        // Counters for all measurements, opened on first use. Null if disabled in the config or if no
+        // counter is available.
+        inline TPerfCounters *perf_counters(TConfig const &config)
+        {
+            static TPerfCounters counters;
+            return config.counters && counters.available() ? &counters : nullptr;
+        }
+
+        // Adds the counters per call and the bandwidth to the statistics of n_calls calls on inputs of
+        // input_bytes bytes
+        inline void add_per_call(TStatistics &statistics, TPerfCounters const *counters, size_t n_calls, size_t input_bytes)
+        {
+            statistics.bandwidth = input_bytes / statistics.median * 1e-6;
+            if (counters)
+            {
+                statistics.counters = counters->read() / n_calls;
+            }
+        }
+
+        // Execution time of one call in ms.
+        // warm: a trial is one pass over all permutations of the dataset, divided by their number.
+        // cold: a trial is one call on the next permutation after the caches have been flushed; there
+        //       are at least as many trials as permutations.
+        template <typename F>
+        TStatistics measure(TDataset const &dataset, F algorithm, TConfig const &config)
+        {
+            auto const counters = perf_counters(config);
+            auto const input_bytes = dataset.front().size() * sizeof(int32_t);
+
+            if (config.cache_mode == CacheMode::warm)
+            {
+                auto samples = sample([] {},
+                                      [&dataset, &algorithm]
+                                      {
+                                          for (const auto &data : dataset)
+                                          {
+                                              [[maybe_unused]] auto volatile result = algorithm(data);
+                                          }
+                                      },
+                                      config.n_warmup, config.n_trials, counters);
+                for (auto &duration : samples)
+                {
+                    duration /= dataset.size();
+                }
+                auto statistics = summarize(samples);
+                add_per_call(statistics, counters, config.n_trials * dataset.size(), input_bytes);
+                return statistics;
+            }
+
+            auto &flusher = cache_flusher(config.flush_size);
+            size_t next = 0;
+            auto const n_trials = std::max(config.n_trials, dataset.size());
+            auto const samples = sample([&flusher] { flusher.flush(); },
+                                        [&dataset, &algorithm, &next]
+                                        {
+                                            [[maybe_unused]] auto volatile result = algorithm(dataset[next++ % dataset.size()]);
+                                        },
+                                        config.n_warmup, n_trials, counters);
+            auto statistics = summarize(samples);
+            add_per_call(statistics, counters, n_trials, input_bytes);
+            return statistics;
+        }
+
+        // Collects the statistics of all measurements of a driver and writes them in the formats
+        // read by notebooks/analyze_timing_data.ipynb.
+        class TReport
+        {
+        public:
+            explicit TReport(TConfig const &config_) : config(config_) {}
+
+            // workload names the input layout, see workloads.h. n_threads is 0 if the algorithm ran
+            // with its default number of threads.
+            void add(std::string const &algorithm, size_t size, TStatistics const &statistics, std::string const &workload = "shuffled",
+                     size_t n_threads = 0)
+            {
+                if (std::find(algorithms.cbegin(), algorithms.cend(), algorithm) == algorithms.cend())
+                {
+                    algorithms.push_back(algorithm);
+                }
+                if (std::find(sizes.cbegin(), sizes.cend(), size) == sizes.cend())
+                {
+                    sizes.push_back(size);
+                }
+                entries.push_back({algorithm, workload, size, n_threads, statistics});
+            }
+
+            // One row per size and one column per algorithm with the median, NaN for algorithms that
+            // were not measured at that size. This is the format of the original results files. Meant
+            // for reports of a single workload.
+            void write_medians_csv(std::string const &path) const
+            {
+                std::ofstream file(path);
+                file << "size";
+                for (auto const &algorithm : algorithms)
+                {
+                    file << ", " << algorithm;
+                }
+                file << "\n";
+
+                for (auto size : sizes)
+                {
+                    file << size;
+                    for (auto const &algorithm : algorithms)
+                    {
+                        auto const entry = find(algorithm, size);
+                        file << ",";
+                        if (entry == entries.cend())
+                        {
+                            file << "NaN";
+                        }
+                        else
+                        {
+                            file << entry->statistics.median;
+                        }
+                    }
+                    file << "\n";
+                }
+            }
+
+            // One row per measurement
+            void write_statistics_csv(std::string const &path) const
+            {
+                std::ofstream file(path);
+                file << "algorithm,workload,size,n_threads,cache_mode,n_trials,median_ms,mad_ms,ci_low_ms,ci_high_ms,mean_ms,min_ms,max_ms,bandwidth_gb_s,"
+                     << "cycles,instructions,branch_misses,l1d_misses,llc_misses\n";
+                for (auto const &entry : entries)
+                {
+                    auto const &s = entry.statistics;
+                    auto const &c = s.counters;
+                    file << entry.algorithm << "," << entry.workload << "," << entry.size << "," << entry.n_threads << "," << to_string(config.cache_mode) << "," << s.n_trials << ","
+                         << s.median << "," << s.mad << "," << s.ci_low << "," << s.ci_high << ","
+                         << s.mean << "," << s.min << "," << s.max << "," << s.bandwidth << ","
+                         << c.cycles << "," << c.instructions << "," << c.branch_misses << "," << c.l1d_misses << "," << c.llc_misses << "\n";
+                }
+            }
+
+            // Same content as write_statistics_csv, as a list of records (pandas.read_json(orient="records"))
+            void write_statistics_json(std::string const &path) const
+            {
+                std::ofstream file(path);
+                file << "[\n";
+                for (size_t i = 0; i < entries.size(); ++i)
+                {
+                    auto const &entry = entries[i];
+                    auto const &s = entry.statistics;
+                    auto const &c = s.counters;
+                    file << "  {\"algorithm\": \"" << entry.algorithm << "\", \"workload\": \"" << entry.workload << "\", \"size\": " << entry.size
+                         << ", \"n_threads\": " << entry.n_threads << ", \"cache_mode\": \"" << to_string(config.cache_mode) << "\", \"n_trials\": " << s.n_trials
+                         << ", \"median_ms\": " << s.median << ", \"mad_ms\": " << s.mad
+                         << ", \"ci_low_ms\": " << s.ci_low << ", \"ci_high_ms\": " << s.ci_high
+                         << ", \"mean_ms\": " << s.mean << ", \"min_ms\": " << s.min << ", \"max_ms\": " << s.max
+                         << ", \"bandwidth_gb_s\": " << json(s.bandwidth) << ", \"cycles\": " << json(c.cycles)
+                         << ", \"instructions\": " << json(c.instructions) << ", \"branch_misses\": " << json(c.branch_misses)
+                         << ", \"l1d_misses\": " << json(c.l1d_misses) << ", \"llc_misses\": " << json(c.llc_misses) << "}"
+                         << (i + 1 < entries.size() ? ",\n" : "\n");
+                }
+                file << "]\n";
+            }
+
+        private:
+            // JSON has no NaN, values that were not recorded are null
+            static std::string json(double value)
+            {
+                return std::isnan(value) ? "null" : std::to_string(value);
+            }
+
+            struct TEntry
+            {
+                std::string algorithm;
+                std::string workload;
+                size_t size;
+                size_t n_threads;
+                TStatistics statistics;
+            };
+
+            std::vector<TEntry>::const_iterator find(std::string const &algorithm, size_t size) const
+            {
+                return std::find_if(entries.cbegin(), entries.cend(),
+                                    [&](TEntry const &entry) { return entry.algorithm == algorithm && entry.size == size; });
+            }
+
+            TConfig config;
+            std::vector<std::string> algorithms;
+            std::vector<size_t> sizes;
+            std::vector<TEntry> entries;
+        };
+    }
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "accumulator.h"
+#include "algorithms.h"
+#include "file_reduce.h"
+#include "simd.h"
+
+namespace top_two
+{
+    // Append-only column of values in fixed-size blocks. Every block starts with a summary, i.e. the
+    // top two of the values in the block, which is updated incrementally when values are appended.
+    // A query merges the block summaries instead of reading the values, so it reads O(blocks) instead
+    // of O(values) bytes, and a handle remembers the merged summary of the full blocks, which never
+    // change again, so a repeated query only reads the summaries of the blocks appended since.
+    //
+    // Layout, in native byte order:
+    //   file header   magic, size and kind of the values, values per block, number of values
+    //   block 0       block header (number of values, second largest, largest), then the values
+    //   block 1       ...
+    // Every block but the last one is full. The number of values in the file header is written last
+    // by an append, so an interrupted append leaves the previous column. A block header that does not
+    // match the number of values in the file header, e.g. after such an interruption, is ignored and
+    // the values of its block are rescanned. There may be one writer at a time.
+    namespace column
+    {
+        constexpr size_t default_block_values = size_t{1} << 16;
+
+        enum class OpenMode
+        {
+            read_write, // opens an existing column
+            create      // creates an empty column, an existing file is truncated
+        };
+
+        namespace detail
+        {
+            constexpr char magic[8] = {'T', 'O', 'P', '2', 'C', 'O', 'L', '1'};
+            constexpr size_t file_header_size = 64;
+            constexpr size_t block_header_size = 64;
+
+            struct TFileHeader
+            {
+                char magic[8];
+                uint32_t value_size;
+                uint32_t value_kind; // 0 unsigned, 1 signed, 2 floating-point
+                uint64_t block_values;
+                uint64_t n_values;
+            };
+
+            template <typename T>
+            struct TBlockHeader
+            {
+                uint64_t n_values; // values covered by the summary
+                T second_largest;
+                T largest;
+            };
+
+            static_assert(sizeof(TFileHeader) <= file_header_size);
+            static_assert(sizeof(TBlockHeader<int64_t>) <= block_header_size);
+
+            template <typename T>
+            constexpr uint32_t value_kind()
+            {
+                return std::is_floating_point_v<T> ? 2 : std::is_signed_v<T> ? 1 : 0;
+            }
+        }
+
+        template <typename T = int32_t>
+        class TColumnFile
+        {
+        public:
+            using TRes = TBasicResult<T>;
+
+            // block_values is only used to create a column, an existing column keeps its block size.
+            // Throws std::system_error on I/O errors and std::runtime_error if the file is not a column
+            // of values of type T.
+            explicit TColumnFile(std::string const &path, OpenMode mode = OpenMode::read_write, size_t block_values_ = default_block_values)
+                : file(path, mode == OpenMode::create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR)
+            {
+                if (mode == OpenMode::create)
+                {
+                    block_values = std::max<size_t>(1, block_values_);
+                    write_file_header();
+                    return;
+                }
+
+                auto const header = read_file_header();
+                if (std::memcmp(header.magic, detail::magic, sizeof(detail::magic)) != 0 || header.value_size != sizeof(T) ||
+                    header.value_kind != detail::value_kind<T>() || header.block_values == 0)
+                {
+                    throw std::runtime_error("not a column of this value type: " + path);
+                }
+                block_values = header.block_values;
+                n_values = header.n_values;
+            }
+
+            size_t size() const { return n_values; }
+
+            size_t n_blocks() const { return (n_values + block_values - 1) / block_values; }
+
+            size_t values_per_block() const { return block_values; }
+
+            // Fills the last block, then appends new blocks. The summary of every touched block is
+            // merged with the top two of the new values instead of rescanning the block.
+            void append(std::span<T const> values)
+            {
+                auto const isa = simd::best_isa();
+                auto total = n_values;
+                for (size_t done = 0; done < values.size();)
+                {
+                    auto const block = total / block_values;
+                    auto const used = total % block_values;
+                    auto const chunk = values.subspan(done, std::min(block_values - used, values.size() - done));
+
+                    file.write(chunk.data(), chunk.size_bytes(), value_offset(block, used));
+                    auto const summary = parallel::ReduceOp<T>{}(used == 0 ? TRes{} : block_summary(block, used),
+                                                                 simd::detail::kernel<T>(isa)(chunk.data(), chunk.data() + chunk.size()));
+                    write_block_header(block, {used + chunk.size(), summary.second_largest, summary.largest});
+
+                    done += chunk.size();
+                    total += chunk.size();
+                }
+                n_values = total;
+                write_file_header();
+            }
+
+            // Top two of the column from the block summaries. Picks up values that were appended by
+            // another handle since the last query.
+            TRes query()
+            {
+                n_values = read_file_header().n_values;
+                auto const n_full = n_values / block_values;
+                for (; n_cached_blocks < n_full; ++n_cached_blocks)
+                {
+                    cached = parallel::ReduceOp<T>{}(cached, block_summary(n_cached_blocks, block_values));
+                }
+
+                auto result = cached;
+                if (auto const rest = n_values % block_values; rest != 0)
+                {
+                    result = parallel::ReduceOp<T>{}(result, block_summary(n_full, rest));
+                }
+                return top_two::detail::finish(result);
+            }
+
+            // Top two of the column from the values, ignoring the summaries
+            TRes scan() const
+            {
+                TopTwoAccumulator<T> accumulator;
+                for (size_t block = 0; block < n_blocks(); ++block)
+                {
+                    auto const values = read_block(block, std::min(block_values, n_values - block * block_values));
+                    accumulator.push(std::span<T const>{values});
+                }
+                return accumulator.result();
+            }
+
+        private:
+            size_t block_offset(size_t block) const
+            {
+                return detail::file_header_size + block * (detail::block_header_size + block_values * sizeof(T));
+            }
+
+            size_t value_offset(size_t block, size_t index) const
+            {
+                return block_offset(block) + detail::block_header_size + index * sizeof(T);
+            }
+
+            detail::TFileHeader read_file_header() const
+            {
+                detail::TFileHeader header{};
+                if (file.read(&header, sizeof(header), 0) != sizeof(header))
+                {
+                    throw std::runtime_error("truncated column header");
+                }
+                return header;
+            }
+
+            void write_file_header() const
+            {
+                detail::TFileHeader header{};
+                std::memcpy(header.magic, detail::magic, sizeof(detail::magic));
+                header.value_size = sizeof(T);
+                header.value_kind = detail::value_kind<T>();
+                header.block_values = block_values;
+                header.n_values = n_values;
+                file.write(&header, sizeof(header), 0);
+            }
+
+            void write_block_header(size_t block, detail::TBlockHeader<T> const &header) const
+            {
+                file.write(&header, sizeof(header), block_offset(block));
+            }
+
+            std::vector<T> read_block(size_t block, size_t count) const
+            {
+                std::vector<T> values(count);
+                if (file.read(values.data(), count * sizeof(T), value_offset(block, 0)) != count * sizeof(T))
+                {
+                    throw std::runtime_error("truncated column block");
+                }
+                return values;
+            }
+
+            // Summary of the first count values of a block, rescanned if the stored one covers
+            // another number of values
+            TRes block_summary(size_t block, size_t count) const
+            {
+                detail::TBlockHeader<T> header{};
+                if (file.read(&header, sizeof(header), block_offset(block)) == sizeof(header) && header.n_values == count)
+                {
+                    return {header.second_largest, header.largest};
+                }
+                auto const values = read_block(block, count);
+                return simd::detail::kernel<T>(simd::best_isa())(values.data(), values.data() + values.size());
+            }
+
+            file::detail::TFile file;
+            size_t block_values = default_block_values;
+            size_t n_values = 0;
+
+            // merged summary of the first n_cached_blocks blocks, which are full
+            size_t n_cached_blocks = 0;
+            TRes cached;
+        };
+    }
+}
@@ -1,55 +1,13 @@
 // Comparison of several solutions for finding the two largest integers in a vector of ints
 //
-#include <chrono>
-#include <fstream>
 #include <iostream>
-#include <random>
 #include <vector>
 
 #include "algorithms.h"
+#include "benchmark.h"
+#include "simd.h"
 
-namespace top_two
-{
-    constexpr static auto duration_in_ms = [](auto start, auto end) -> double
-    {
-        return std::chrono::duration<double, std::milli>(end - start).count();
-    };
-
-    using TDataset = std::vector<std::vector<int32_t>>;
-
-    auto make_dataset(size_t size, size_t n_permutations)
-    {
-        std::vector<int32_t> data(size);
-        std::iota(data.begin(), data.end(), 0);
-        TDataset dataset;
-        dataset.reserve(n_permutations);
-
-        std::mt19937 rng(19937);
-
-        for (size_t i = 0; i < n_permutations; ++i)
-        {
-            std::shuffle(data.begin(), data.end(), rng);
-            dataset.push_back(data);
-        }
-
-        return dataset;
-    }
-
-    template <typename F>
-    double calculate_duration(TDataset dataset, F algorithm)
-    {
-        auto const start = std::chrono::high_resolution_clock::now();
-        for (const auto &data : dataset)
-        {
-            auto volatile result = algorithm(data);
-        }
-        auto const end = std::chrono::high_resolution_clock::now();
-
-        return duration_in_ms(start, end) / dataset.size();
-    }
-}
-
-int32_t main()
+int32_t main(int32_t argc, char **argv)
 {
     const std::vector<size_t> sizes{
          10
@@ -68,41 +26,43 @@ int32_t main()
         //, 1'875'061 
         //, 10'000'000
     };
-    const size_t n_permutations = 1'000;
+    auto const config = top_two::benchmark::parse_config(argc, argv);
 
-    std::cout << "Using " << n_permutations << " permutations\n";
+    std::cout << "Using " << config.n_permutations << " permutations, " << config.n_trials << " trials, "
+              << top_two::benchmark::to_string(config.cache_mode) << " caches\n";
+    if (config.counters && !top_two::benchmark::perf_counters(config))
+    {
+        std::cout << "Hardware performance counters are not available, the counter columns will be NaN\n";
+    }
 
-    std::ofstream results("results/comparison_of_algorithms_sequential.csv");
-    results << "size, sort, nth_element, max_element, max_element_ben_deane, accumulate, transform_reduce\n";
+    top_two::benchmark::TReport report(config);
 
     for (auto size : sizes)
     {
-        auto const dataset = top_two::make_dataset(size, n_permutations);
+        auto const dataset = top_two::make_dataset(size, config.n_permutations);
         std::cout << "Dataset: " << dataset.size() << " x " << dataset.front().size() << " = " << dataset.size() * dataset.front().size() << " elements\n";
 
-        auto const duration_sort = size > 100'000 ? -1 : calculate_duration(dataset, top_two::sequential::sort);
-        auto const duration_nth_element = calculate_duration(dataset, top_two::sequential::nth_element);
-        auto const duration_max_element = calculate_duration(dataset, top_two::sequential::max_element);
-        auto const duration_max_element_ben_deane = calculate_duration(dataset, top_two::sequential::max_element_ben_deane);
-        auto const duration_accumulate = calculate_duration(dataset, top_two::sequential::accumulate);
-        auto const duration_transform_reduce = calculate_duration(dataset, top_two::sequential::transform_reduce);
-
-        results
-            << size << ",";
-        if (duration_sort == -1)
+        auto const measure = [&](std::string const &algorithm, auto function)
         {
-            results << "NaN,";
-        }
-        else
+            report.add(algorithm, size, top_two::benchmark::measure(dataset, function, config));
+        };
+
+        if (size <= 100'000)
         {
-            results << duration_sort << ",";
+            measure("sort", top_two::sequential::sort<int32_t>);
         }
-        results
-            << duration_nth_element << ","
-            << duration_max_element << ","
-            << duration_max_element_ben_deane << ","
-            << duration_accumulate << ","
-            << duration_transform_reduce << "\n";
+        measure("nth_element", top_two::sequential::nth_element<int32_t>);
+        measure("max_element", top_two::sequential::max_element<int32_t>);
+        measure("max_element_ben_deane", top_two::sequential::max_element_ben_deane<int32_t>);
+        measure("accumulate", top_two::sequential::accumulate<int32_t>);
+        measure("accumulate_branchless", top_two::sequential::accumulate_branchless<int32_t>);
+        measure("accumulate_adaptive", top_two::sequential::accumulate_adaptive<int32_t>);
+        measure("transform_reduce", top_two::sequential::transform_reduce<int32_t>);
+        measure("simd_accumulate", [](auto const &data) { return top_two::simd::accumulate(data); });
     }
+
+    report.write_medians_csv("results/comparison_of_algorithms_sequential.csv");
+    report.write_statistics_csv("results/comparison_of_algorithms_sequential_statistics.csv");
+    report.write_statistics_json("results/comparison_of_algorithms_sequential_statistics.json");
     return 0;
 }
@@ -0,0 +1,116 @@
+// Comparison of per-vector calls and the batch API for many small vectors
+//
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "algorithms.h"
+#include "batch.h"
+#include "benchmark.h"
+#include "simd.h"
+
+namespace top_two
+{
+    // Flat buffer of n_vectors vectors with lengths drawn uniformly from [min_size, max_size]
+    struct TBatch
+    {
+        std::vector<int32_t> values;
+        std::vector<size_t> offsets{0};
+    };
+
+    auto make_batch(size_t min_size, size_t max_size, size_t n_vectors)
+    {
+        std::mt19937 rng(19937);
+        std::uniform_int_distribution<size_t> size_distribution(min_size, max_size);
+
+        TBatch batch;
+        for (size_t i = 0; i < n_vectors; ++i)
+        {
+            auto const size = size_distribution(rng);
+            auto const first = batch.values.size();
+            batch.values.resize(first + size);
+            std::iota(batch.values.begin() + first, batch.values.end(), 0);
+            std::shuffle(batch.values.begin() + first, batch.values.end(), rng);
+            batch.offsets.push_back(batch.values.size());
+        }
+        return batch;
+    }
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    const std::vector<std::pair<size_t, size_t>> sizes{
+        {10, 10}
+        , {100, 100}
+        , {1'000, 1'000}
+        , {10, 1'000}
+    };
+    const size_t n_vectors = 100'000;
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << n_vectors << " vectors, " << config.n_trials << " trials, " << top_two::benchmark::to_string(config.cache_mode) << " caches\n";
+
+    std::ofstream results("results/comparison_of_algorithms_batch.csv");
+    results << "min_size, max_size, accumulate, simd_accumulate, batch_accumulate, batch_reduce\n";
+
+    top_two::benchmark::TReport report(config);
+
+    auto const per_vector = [](auto algorithm)
+    {
+        return [algorithm](top_two::TBatch const &batch, std::vector<top_two::TResult> &results)
+        {
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                results[i] = algorithm(std::span<int32_t const>{batch.values}.subspan(batch.offsets[i], batch.offsets[i + 1] - batch.offsets[i]));
+            }
+        };
+    };
+
+    for (auto [min_size, max_size] : sizes)
+    {
+        auto const batch = top_two::make_batch(min_size, max_size, n_vectors);
+        std::cout << "Batch: " << n_vectors << " vectors of " << min_size << " to " << max_size << " elements\n";
+
+        std::vector<top_two::TResult> batch_results(n_vectors);
+
+        // Vectors per second of the median trial, one trial reduces the whole batch
+        auto const measure = [&](std::string const &algorithm, auto run)
+        {
+            auto const samples = top_two::benchmark::sample([&config]
+                                                            {
+                                                                if (config.cache_mode == top_two::benchmark::CacheMode::cold)
+                                                                {
+                                                                    top_two::benchmark::cache_flusher(config.flush_size).flush();
+                                                                }
+                                                            },
+                                                            [&] { run(batch, batch_results); },
+                                                            config.n_warmup, config.n_trials);
+            auto statistics = top_two::benchmark::summarize(samples);
+            statistics.bandwidth = batch.values.size() * sizeof(int32_t) / statistics.median * 1e-6;
+            report.add(algorithm + "<" + std::to_string(min_size) + "-" + std::to_string(max_size) + ">", batch.values.size(), statistics);
+            return n_vectors / statistics.median * 1'000.0;
+        };
+
+        auto const throughput_accumulate = measure("accumulate", per_vector(top_two::sequential::accumulate<int32_t>));
+        auto const throughput_simd_accumulate = measure("simd_accumulate", per_vector([](std::span<int32_t const> values)
+                                                                                      { return top_two::simd::detail::kernel<int32_t>(top_two::simd::best_isa())(values.data(), values.data() + values.size()); }));
+        auto const throughput_batch_accumulate = measure("batch_accumulate", [](top_two::TBatch const &batch, std::vector<top_two::TResult> &results)
+                                                         { top_two::batch::sequential::accumulate<int32_t>(batch.values, batch.offsets, results); });
+        auto const throughput_batch_reduce = measure("batch_reduce", [](top_two::TBatch const &batch, std::vector<top_two::TResult> &results)
+                                                     { top_two::batch::parallel::reduce<int32_t>(batch.values, batch.offsets, results); });
+
+        results
+            << min_size << ","
+            << max_size << ","
+            << throughput_accumulate << ","
+            << throughput_simd_accumulate << ","
+            << throughput_batch_accumulate << ","
+            << throughput_batch_reduce << "\n";
+    }
+
+    report.write_statistics_csv("results/comparison_of_batch_statistics.csv");
+    report.write_statistics_json("results/comparison_of_batch_statistics.json");
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Throughput of the top two of a large binary file, compared to reading the file without reducing it,
+// and queries of a column file with the same values, which only read the block summaries
+//
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "column_file.h"
+#include "file_reduce.h"
+
+namespace top_two
+{
+    // Writes the same random values to a raw file and to a column file
+    void write_files(std::string const &path, std::string const &column_path, size_t n_values)
+    {
+        std::ofstream file(path, std::ios::binary);
+        column::TColumnFile<int32_t> column(column_path, column::OpenMode::create);
+        std::mt19937 rng(19937);
+        std::vector<int32_t> block(size_t{1} << 20);
+        for (size_t written = 0; written < n_values; written += block.size())
+        {
+            for (auto &value : block)
+            {
+                value = static_cast<int32_t>(rng());
+            }
+            auto const n = std::min(block.size(), n_values - written);
+            file.write(reinterpret_cast<char const *>(block.data()), static_cast<std::streamsize>(n * sizeof(int32_t)));
+            column.append(std::span<int32_t const>{block.data(), n});
+        }
+    }
+}
+
+// Options of the benchmark harness, and --file-size BYTES (default 1 GiB) and --path PATH.
+// With --cold, the file is evicted from the page cache before every trial.
+int32_t main(int32_t argc, char **argv)
+{
+    size_t file_size = size_t{1} << 30;
+    std::string path = "results/comparison_of_file_reduction.bin";
+    for (int32_t i = 1; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--file-size") == 0)
+        {
+            file_size = std::stoul(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--path") == 0)
+        {
+            path = argv[i + 1];
+        }
+    }
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+    auto const cold = config.cache_mode == top_two::benchmark::CacheMode::cold;
+
+    auto const column_path = path + ".column";
+
+    std::cout << "Writing " << file_size << " bytes to " << path << " and " << column_path << "\n";
+    top_two::write_files(path, column_path, file_size / sizeof(int32_t));
+    std::cout << "Using " << config.n_trials << " trials, " << (cold ? "evicted" : "cached") << " file\n";
+
+    top_two::benchmark::TReport report(config);
+    auto const measure = [&](std::string const &name, auto run)
+    {
+        auto const samples = top_two::benchmark::sample([&]
+                                                        {
+                                                            if (cold)
+                                                            {
+                                                                top_two::file::evict(path);
+                                                                top_two::file::evict(column_path);
+                                                            }
+                                                        },
+                                                        run, config.n_warmup, config.n_trials);
+        auto statistics = top_two::benchmark::summarize(samples);
+        statistics.bandwidth = file_size / statistics.median * 1e-6;
+        report.add(name, file_size, statistics, "random");
+        std::cout << name << ": " << statistics.bandwidth << " GB/s\n";
+    };
+
+    for (size_t block_size : {size_t{1} << 20, size_t{8} << 20})
+    {
+        auto const suffix = "/" + std::to_string(block_size >> 20) + "MiB";
+        measure("read" + suffix, [&] { top_two::file::read_all(path, {top_two::file::IoMode::pread, block_size}); });
+        measure("mmap" + suffix, [&] { [[maybe_unused]] auto volatile result = top_two::file::reduce<int32_t>(path, {top_two::file::IoMode::mmap, block_size}).largest; });
+        measure("pread" + suffix, [&] { [[maybe_unused]] auto volatile result = top_two::file::reduce<int32_t>(path, {top_two::file::IoMode::pread, block_size}).largest; });
+    }
+
+    // a new handle per query, so that every block summary is read
+    measure("column::query", [&] { [[maybe_unused]] auto volatile result = top_two::column::TColumnFile<int32_t>(column_path).query().largest; });
+    measure("column::scan", [&] { [[maybe_unused]] auto volatile result = top_two::column::TColumnFile<int32_t>(column_path).scan().largest; });
+
+    report.write_statistics_csv("results/comparison_of_file_reduction_statistics.csv");
+    report.write_statistics_json("results/comparison_of_file_reduction_statistics.json");
+    std::remove(path.c_str());
+    std::remove(column_path.c_str());
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Top two of many small inputs whose size is known at compile time, e.g. per-request feature
+// vectors: fixed_size::accumulate compared to the algorithms for inputs of any size
+//
+#include <array>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "algorithms.h"
+#include "benchmark.h"
+#include "fixed_size.h"
+
+// Inputs per trial, so that a trial takes long enough to be timed
+constexpr size_t n_inputs = 10'000;
+
+template <size_t N>
+void measure_size(top_two::benchmark::TReport &report, top_two::benchmark::TConfig const &config)
+{
+    std::cout << "Size: " << N << "\n";
+    std::mt19937 rng(19937);
+    std::vector<std::array<int32_t, N>> inputs(n_inputs);
+    for (auto &input : inputs)
+    {
+        std::generate(input.begin(), input.end(), [&rng] { return static_cast<int32_t>(rng()); });
+    }
+
+    auto const measure = [&](std::string const &algorithm, auto function)
+    {
+        auto const samples = top_two::benchmark::sample([] {},
+                                                        [&]
+                                                        {
+                                                            for (auto const &input : inputs)
+                                                            {
+                                                                auto const result = function(input);
+                                                                [[maybe_unused]] auto volatile largest = result.largest;
+                                                                [[maybe_unused]] auto volatile second_largest = result.second_largest;
+                                                            }
+                                                        },
+                                                        config.n_warmup, config.n_trials);
+        report.add(algorithm, N, top_two::benchmark::summarize(samples));
+    };
+
+    measure("sequential::accumulate", [](auto const &input) { return top_two::sequential::accumulate<int32_t>(input); });
+    measure("sequential::accumulate_branchless", [](auto const &input) { return top_two::sequential::accumulate_branchless<int32_t>(input); });
+    measure("sequential::max_element", [](auto const &input) { return top_two::sequential::max_element<int32_t>(input); });
+    measure("fixed_size::accumulate", [](auto const &input) { return top_two::fixed_size::accumulate(input); });
+}
+
+template <size_t... Ns>
+void measure_sizes(top_two::benchmark::TReport &report, top_two::benchmark::TConfig const &config, std::index_sequence<Ns...>)
+{
+    (measure_size<Ns>(report, config), ...);
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << n_inputs << " inputs per trial, " << config.n_trials << " trials\n";
+
+    top_two::benchmark::TReport report(config);
+    measure_sizes(report, config, std::index_sequence<4, 10, 16, 32, 64, 100, 128, 256>{});
+
+    report.write_statistics_csv("results/comparison_of_fixed_sizes_statistics.csv");
+    report.write_statistics_json("results/comparison_of_fixed_sizes_statistics.json");
+    return 0;
+}
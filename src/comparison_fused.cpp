@@ -0,0 +1,88 @@
+// Min, max, sum, count, top two and bottom two of the same values: one pass per statistic compared
+// to one fused pass for all of them, and to the top two alone
+//
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "fused.h"
+
+namespace fused = top_two::fused;
+
+// One pass per statistic
+template <template <typename, typename...> class Algorithm>
+size_t separate(std::vector<int32_t> const &values)
+{
+    auto const min = Algorithm<int32_t, fused::Min>::run(values).template get<fused::Min>();
+    auto const max = Algorithm<int32_t, fused::Max>::run(values).template get<fused::Max>();
+    auto const sum = Algorithm<int32_t, fused::Sum>::run(values).template get<fused::Sum>();
+    auto const count = Algorithm<int32_t, fused::Count>::run(values).template get<fused::Count>();
+    auto const top_two = Algorithm<int32_t, fused::TopTwo>::run(values).template get<fused::TopTwo>();
+    auto const bottom_two = Algorithm<int32_t, fused::BottomTwo>::run(values).template get<fused::BottomTwo>();
+    return min + max + sum + count + top_two.largest + bottom_two.largest;
+}
+
+template <template <typename, typename...> class Algorithm>
+size_t all(std::vector<int32_t> const &values)
+{
+    auto const result = Algorithm<int32_t, fused::Min, fused::Max, fused::Sum, fused::Count, fused::TopTwo, fused::BottomTwo>::run(values);
+    return result.template get<fused::Min>() + result.template get<fused::Max>() + result.template get<fused::Sum>() +
+           result.template get<fused::Count>() + result.template get<fused::TopTwo>().largest + result.template get<fused::BottomTwo>().largest;
+}
+
+template <template <typename, typename...> class Algorithm>
+size_t top_two_only(std::vector<int32_t> const &values)
+{
+    return Algorithm<int32_t, fused::TopTwo>::run(values).template get<fused::TopTwo>().largest;
+}
+
+template <typename T, typename... Stats>
+struct Sequential
+{
+    static fused::TFused<T, Stats...> run(std::vector<T> const &values) { return fused::sequential::accumulate<T, Stats...>(values); }
+};
+
+template <typename T, typename... Stats>
+struct Parallel
+{
+    static fused::TFused<T, Stats...> run(std::vector<T> const &values) { return fused::parallel::reduce<T, Stats...>(values); }
+};
+
+int32_t main(int32_t argc, char **argv)
+{
+    const std::vector<size_t> sizes{
+         100'000
+        , 1'000'000
+        , 10'000'000
+        //, 100'000'000
+    };
+    const size_t n_permutations = 2;
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << n_permutations << " permutations, " << config.n_trials << " trials, "
+              << top_two::benchmark::to_string(config.cache_mode) << " caches\n";
+
+    top_two::benchmark::TReport report(config);
+
+    for (auto size : sizes)
+    {
+        auto const dataset = top_two::make_dataset(size, n_permutations);
+        std::cout << "Size: " << size << "\n";
+
+        auto const measure = [&](std::string const &algorithm, auto function)
+        {
+            report.add(algorithm, size, top_two::benchmark::measure(dataset, function, config));
+        };
+
+        measure("sequential::top_two", top_two_only<Sequential>);
+        measure("sequential::separate", separate<Sequential>);
+        measure("sequential::fused", all<Sequential>);
+        measure("parallel::top_two", top_two_only<Parallel>);
+        measure("parallel::separate", separate<Parallel>);
+        measure("parallel::fused", all<Parallel>);
+    }
+
+    report.write_statistics_csv("results/comparison_of_fused_statistics.csv");
+    report.write_statistics_json("results/comparison_of_fused_statistics.json");
+    return 0;
+}
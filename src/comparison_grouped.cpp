@@ -0,0 +1,78 @@
+// Top two per key: the grouped aggregation with one table, with thread-local tables, radix
+// partitioned and with the automatic choice, compared to std::unordered_map as the table
+//
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmark.h"
+#include "grouped.h"
+
+int32_t main(int32_t argc, char **argv)
+{
+    const std::vector<size_t> sizes{
+         1'000'000
+        , 10'000'000
+        //, 100'000'000
+    };
+    const std::vector<size_t> key_counts{
+         100
+        , 10'000
+        , 1'000'000
+    };
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << config.n_trials << " trials\n";
+
+    top_two::benchmark::TReport report(config);
+
+    for (auto size : sizes)
+    {
+        auto const values = top_two::make_dataset(size, 1).front();
+        std::span<int32_t const> const value_column{values};
+
+        for (auto n_keys : key_counts)
+        {
+            std::cout << "Size: " << size << ", keys: " << n_keys << "\n";
+            std::mt19937 rng(19937);
+            std::uniform_int_distribution<int32_t> key_distribution(0, static_cast<int32_t>(n_keys) - 1);
+            std::vector<int32_t> keys(size);
+            std::generate(keys.begin(), keys.end(), [&] { return key_distribution(rng); });
+            std::span<int32_t const> const key_column{keys};
+
+            auto const measure = [&](std::string const &algorithm, auto run)
+            {
+                auto const samples = top_two::benchmark::sample([] {},
+                                                                [&]
+                                                                {
+                                                                    auto const n_groups = run();
+                                                                    [[maybe_unused]] auto volatile result = n_groups;
+                                                                },
+                                                                config.n_warmup, config.n_trials);
+                report.add(algorithm + "<" + std::to_string(n_keys) + ">", size, top_two::benchmark::summarize(samples));
+            };
+
+            measure("unordered_map", [&]
+                    {
+                        std::unordered_map<int32_t, top_two::TResult> groups;
+                        for (size_t i = 0; i < size; ++i)
+                        {
+                            auto &result = groups[keys[i]];
+                            result = top_two::parallel::ReduceOp<int32_t>{}(result, values[i]);
+                        }
+                        return groups.size();
+                    });
+            measure("sequential::accumulate", [&] { return top_two::grouped::sequential::accumulate<int32_t>(key_column, value_column).size(); });
+            measure("parallel::reduce_local", [&] { return top_two::grouped::parallel::reduce_local<int32_t>(key_column, value_column).size(); });
+            measure("parallel::reduce_partitioned", [&] { return top_two::grouped::parallel::reduce_partitioned<int32_t>(key_column, value_column).size(); });
+            measure("parallel::reduce", [&] { return top_two::grouped::parallel::reduce<int32_t>(key_column, value_column).size(); });
+        }
+    }
+
+    report.write_statistics_csv("results/comparison_of_grouped_statistics.csv");
+    report.write_statistics_json("results/comparison_of_grouped_statistics.json");
+    return 0;
+}
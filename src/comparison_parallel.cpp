@@ -1,55 +1,44 @@
 // Comparison of several solutions for finding the two largest integers in a vector of ints
 //
-#include <chrono>
-#include <fstream>
 #include <iostream>
-#include <random>
+#include <thread>
 #include <vector>
 
 #include "algorithms.h"
+#include "backends.h"
+#include "benchmark.h"
+#include "dispatch.h"
+#include "simd.h"
+#include "thread_pool.h"
 
 namespace top_two
 {
-    constexpr static auto duration_in_ms = [](auto start, auto end) -> double
+    // Every parallel algorithm on one backend, named "<backend>/<algorithm>"
+    template <typename Backend>
+    void measure_backend(benchmark::TReport &report, TDataset const &dataset, std::string const &backend_name, size_t n_threads,
+                         benchmark::TConfig const &config)
     {
-        return std::chrono::duration<double, std::milli>(end - start).count();
-    };
-
-    using TDataset = std::vector<std::vector<int32_t>>;
-
-    auto make_dataset(size_t size, size_t n_permutations)
-    {
-        std::vector<int32_t> data(size);
-        std::iota(data.begin(), data.end(), 0);
-        TDataset dataset;
-        dataset.reserve(n_permutations);
-
-        std::mt19937 rng(19937);
-
-        for (size_t i = 0; i < n_permutations; ++i)
+        auto const size = dataset.front().size();
+        auto const measure = [&](std::string const &algorithm, auto function)
         {
-            std::shuffle(data.begin(), data.end(), rng);
-            dataset.push_back(data);
-        }
+            report.add(backend_name + "/" + algorithm, size, benchmark::measure(dataset, function, config), "shuffled", n_threads);
+        };
 
-        return dataset;
-    }
-
-    template <typename F>
-    double calculate_duration(TDataset dataset, F algorithm)
-    {
-        auto const start = std::chrono::high_resolution_clock::now();
-        for (const auto &data : dataset)
+        if (size <= 1'000'000)
         {
-            auto volatile result = algorithm(data);
+            measure("sort", parallel::sort<int32_t, Less<int32_t>, Backend>);
         }
-        auto const end = std::chrono::high_resolution_clock::now();
-
-        return duration_in_ms(start, end) / dataset.size();
+        measure("nth_element", parallel::nth_element<int32_t, Less<int32_t>, Backend>);
+        measure("max_element", parallel::max_element<int32_t, Less<int32_t>, Backend>);
+        measure("max_element_ben_deane", parallel::max_element_ben_deane<int32_t, Less<int32_t>, Backend>);
+        measure("reduce", parallel::reduce<int32_t, Less<int32_t>, Backend>);
+        measure("transform_reduce", parallel::transform_reduce<int32_t, Less<int32_t>, Backend>);
     }
 }
 
-int32_t main()
+// Options of the benchmark harness. After the comparison of the algorithms with their defaults,
+// every algorithm runs on every backend with 1, 2, 4, ... threads up to one per hardware thread.
+int32_t main(int32_t argc, char **argv)
 {
     const std::vector<size_t> sizes{
          10
@@ -66,48 +55,82 @@ int32_t main()
         //, 3'162'278 
         //, 10'000'000
     };
-    const size_t n_permutations = 1'000;
+    auto const config = top_two::benchmark::parse_config(argc, argv);
 
-    std::cout << "Using " << n_permutations << " permutations\n";
+    std::cout << "Using " << config.n_permutations << " permutations, " << config.n_trials << " trials, "
+              << top_two::benchmark::to_string(config.cache_mode) << " caches\n";
+    if (config.counters && !top_two::benchmark::perf_counters(config))
+    {
+        std::cout << "Hardware performance counters are not available, the counter columns will be NaN\n";
+    }
 
-    std::ofstream results("results/comparison_of_algorithms_parallel.csv");
-    results << "size, sort, nth_element, max_element, max_element_ben_deane, reduce, transform_reduce\n";
+    top_two::benchmark::TReport report(config);
 
     for (auto size : sizes)
     {
-        auto const dataset = top_two::make_dataset(size, n_permutations);
+        auto const dataset = top_two::make_dataset(size, config.n_permutations);
         std::cout << "Dataset: " << dataset.size() << " x " << dataset.front().size() << " = " << dataset.size() * dataset.front().size() << " elements\n";
 
-        auto const duration_sort = size > 500'000 ? -1 : top_two::calculate_duration(dataset, top_two::parallel::sort);
-        auto const duration_nth_element = size > 5'000'000 ? -1 : top_two::calculate_duration(dataset, top_two::parallel::nth_element);
-        auto const duration_max_element = top_two::calculate_duration(dataset, top_two::parallel::max_element);
-        auto const duration_max_element_ben_deane = top_two::calculate_duration(dataset, top_two::parallel::max_element_ben_deane);
-        auto const duration_reduce = top_two::calculate_duration(dataset, top_two::parallel::reduce);
-        auto const duration_transform_reduce = top_two::calculate_duration(dataset, top_two::parallel::transform_reduce);
-
-        results
-            << size << ",";
-        if (duration_sort == -1)
+        auto const measure = [&](std::string const &algorithm, auto function)
         {
-            results << "NaN,";
-        }
-        else
+            report.add(algorithm, size, top_two::benchmark::measure(dataset, function, config));
+        };
+
+        if (size <= 500'000)
         {
-            results << duration_sort << ",";
+            measure("sort", top_two::parallel::sort<int32_t>);
         }
-        if (duration_nth_element == -1)
+        if (size <= 5'000'000)
         {
-            results << "NaN,";
+            measure("nth_element", top_two::parallel::nth_element<int32_t>);
         }
-        else
+        measure("max_element", top_two::parallel::max_element<int32_t>);
+        measure("max_element_ben_deane", top_two::parallel::max_element_ben_deane<int32_t>);
+        measure("reduce", top_two::parallel::reduce<int32_t>);
+        measure("transform_reduce", top_two::parallel::transform_reduce<int32_t>);
+        measure("simd_reduce", [](auto const &data) { return top_two::simd::reduce(data); });
+        measure("pool_reduce", [](auto const &data) { return top_two::parallel::pool::reduce<int32_t>(data); });
+        measure("dispatch", [](auto const &data) { return top_two::dispatch<int32_t>(data); });
+    }
+
+    report.write_medians_csv("results/comparison_of_algorithms_parallel.csv");
+    report.write_statistics_csv("results/comparison_of_algorithms_parallel_statistics.csv");
+    report.write_statistics_json("results/comparison_of_algorithms_parallel_statistics.json");
+
+    const std::vector<size_t> backend_sizes{
+         10'000
+        , 1'000'000
+        , 10'000'000
+    };
+    std::vector<size_t> thread_counts;
+    auto const max_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t n_threads = 1; n_threads < max_threads; n_threads *= 2)
+    {
+        thread_counts.push_back(n_threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    top_two::benchmark::TReport backend_report(config);
+    for (auto size : backend_sizes)
+    {
+        auto const dataset = top_two::make_dataset(size, 10);
+        for (auto n_threads : thread_counts)
         {
-            results << duration_nth_element << ",";
+            std::cout << "Backends: " << size << " elements, " << n_threads << " threads\n";
+            top_two::backend::set_n_threads(n_threads);
+            top_two::measure_backend<top_two::backend::ParUnseq>(backend_report, dataset, "std::par_unseq", n_threads, config);
+            top_two::measure_backend<top_two::backend::Par>(backend_report, dataset, "std::par", n_threads, config);
+            top_two::measure_backend<top_two::backend::Unseq>(backend_report, dataset, "std::unseq", n_threads, config);
+            top_two::measure_backend<top_two::backend::Threads>(backend_report, dataset, "std::thread", n_threads, config);
+#ifdef _OPENMP
+            top_two::measure_backend<top_two::backend::OpenMP>(backend_report, dataset, "openmp", n_threads, config);
+            top_two::measure_backend<top_two::backend::Gnu>(backend_report, dataset, "gnu_parallel", n_threads, config);
+#endif
         }
-        results
-            << duration_max_element << ","
-            << duration_max_element_ben_deane << ","
-            << duration_reduce << ","
-            << duration_transform_reduce << "\n";
     }
+    top_two::backend::set_n_threads(0);
+
+    backend_report.write_statistics_csv("results/comparison_of_backends_statistics.csv");
+    backend_report.write_statistics_json("results/comparison_of_backends_statistics.json");
     return 0;
 }
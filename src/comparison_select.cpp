@@ -0,0 +1,73 @@
+// The k largest values for large k: top_k::parallel::select compared to selecting on a copy of the
+// input, which is what parallel::nth_element does, and to a sequential partial sort into a buffer of k
+//
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "select.h"
+
+int32_t main(int32_t argc, char **argv)
+{
+    const std::vector<size_t> sizes{
+         1'000'000
+        , 10'000'000
+        //, 100'000'000
+    };
+    const std::vector<size_t> ks{
+         1'000
+        , 10'000
+        , 100'000
+    };
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << config.n_trials << " trials\n";
+
+    top_two::benchmark::TReport report(config);
+
+    for (auto size : sizes)
+    {
+        auto const values = top_two::make_dataset(size, 1).front();
+        std::span<int32_t const> const input{values};
+
+        for (auto k : ks)
+        {
+            std::cout << "Size: " << size << ", k: " << k << "\n";
+            auto const measure = [&](std::string const &algorithm, auto run)
+            {
+                auto const samples = top_two::benchmark::sample([] {},
+                                                                [&]
+                                                                {
+                                                                    auto const result = run();
+                                                                    [[maybe_unused]] auto volatile largest = result.back();
+                                                                },
+                                                                config.n_warmup, config.n_trials);
+                report.add(algorithm + "<" + std::to_string(k) + ">", size, top_two::benchmark::summarize(samples));
+            };
+
+            measure("nth_element_copy", [&]
+                    {
+                        std::vector<int32_t> copy(values);
+                        std::nth_element(std::execution::par_unseq, copy.begin(), copy.begin() + (k - 1), copy.end(), std::greater<>{});
+                        copy.resize(k);
+                        return copy;
+                    });
+            measure("partial_sort_copy", [&]
+                    {
+                        std::vector<int32_t> result(k);
+                        std::partial_sort_copy(values.cbegin(), values.cend(), result.begin(), result.end(), std::greater<>{});
+                        return result;
+                    });
+            measure("select", [&] { return top_two::top_k::parallel::select<int32_t>(input, k); });
+            measure("select_sorted", [&] { return top_two::top_k::parallel::select<int32_t>(input, k, top_two::top_k::Order::sorted); });
+        }
+    }
+
+    report.write_statistics_csv("results/comparison_of_select_statistics.csv");
+    report.write_statistics_json("results/comparison_of_select_statistics.json");
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Top two after every point update of a live array: a tournament tree per fan-out compared to a
+// pass of sequential::accumulate over the whole array
+//
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "algorithms.h"
+#include "benchmark.h"
+#include "tournament_tree.h"
+
+int32_t main(int32_t argc, char **argv)
+{
+    const std::vector<size_t> sizes{
+         1'000
+        , 100'000
+        , 1'000'000
+        , 10'000'000
+    };
+    const size_t n_updates = 1'000;
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << n_updates << " updates per trial, " << config.n_trials << " trials\n";
+
+    top_two::benchmark::TReport report(config);
+
+    for (auto size : sizes)
+    {
+        std::cout << "Size: " << size << "\n";
+        auto values = top_two::make_dataset(size, 1).front();
+
+        std::mt19937 rng(19937);
+        std::uniform_int_distribution<size_t> index_distribution(0, size - 1);
+        std::uniform_int_distribution<int32_t> value_distribution(0, static_cast<int32_t>(size));
+        std::vector<std::pair<size_t, int32_t>> updates(n_updates);
+        for (auto &[index, value] : updates)
+        {
+            index = index_distribution(rng);
+            value = value_distribution(rng);
+        }
+
+        // time per update and query
+        auto const measure = [&](std::string const &algorithm, auto run)
+        {
+            auto statistics = top_two::benchmark::summarize(top_two::benchmark::sample([] {}, run, config.n_warmup, config.n_trials));
+            for (auto *statistic : {&statistics.median, &statistics.mad, &statistics.ci_low, &statistics.ci_high, &statistics.mean, &statistics.min, &statistics.max})
+            {
+                *statistic /= n_updates;
+            }
+            report.add(algorithm, size, statistics, "point_updates");
+        };
+
+        if (size <= 1'000'000)
+        {
+            measure("sequential::accumulate", [&]
+                    {
+                        for (auto const &[index, value] : updates)
+                        {
+                            values[index] = value;
+                            [[maybe_unused]] auto volatile result = top_two::sequential::accumulate<int32_t>(values).largest;
+                        }
+                    });
+        }
+
+        auto const measure_tree = [&](std::string const &algorithm, auto tree)
+        {
+            measure(algorithm, [&]
+                    {
+                        for (auto const &[index, value] : updates)
+                        {
+                            tree.update(index, value);
+                            [[maybe_unused]] auto volatile result = tree.top_two().largest;
+                        }
+                    });
+        };
+        measure_tree("tournament_tree<2>", top_two::TTournamentTree<int32_t, top_two::Less<int32_t>, 2>(values));
+        measure_tree("tournament_tree<8>", top_two::TTournamentTree<int32_t, top_two::Less<int32_t>, 8>(values));
+        measure_tree("tournament_tree<16>", top_two::TTournamentTree<int32_t, top_two::Less<int32_t>, 16>(values));
+    }
+
+    report.write_medians_csv("results/comparison_of_updates.csv");
+    report.write_statistics_csv("results/comparison_of_updates_statistics.csv");
+    report.write_statistics_json("results/comparison_of_updates_statistics.json");
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Top two of the last W values of a stream after every new value: a TSlidingWindow compared to
+// recomputing the top two of the window, and a TSlidingWindow that is advanced by chunks of 1024 values
+//
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "algorithms.h"
+#include "benchmark.h"
+#include "simd.h"
+#include "sliding_window.h"
+
+int32_t main(int32_t argc, char **argv)
+{
+    const size_t stream_size = 100'000;
+    const std::vector<size_t> window_sizes{
+         16
+        , 1'024
+        , 65'536
+    };
+    const size_t chunk_size = 1'024;
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << config.n_trials << " trials\n";
+
+    top_two::benchmark::TReport report(config);
+    auto const stream = top_two::make_dataset(stream_size, 1).front();
+    auto const kernel = top_two::simd::detail::kernel<int32_t>(top_two::simd::best_isa());
+
+    for (auto window_size : window_sizes)
+    {
+        std::cout << "Window: " << window_size << "\n";
+        auto const measure = [&](std::string const &algorithm, auto run)
+        {
+            auto const samples = top_two::benchmark::sample([] {}, run, config.n_warmup, config.n_trials);
+            report.add(algorithm + "<" + std::to_string(window_size) + ">", stream_size, top_two::benchmark::summarize(samples));
+        };
+
+        // the window is the range of the stream that ends at the new value
+        measure("recompute", [&]
+                {
+                    for (size_t i = 0; i < stream_size; ++i)
+                    {
+                        auto const first = i + 1 - std::min(i + 1, window_size);
+                        [[maybe_unused]] auto volatile largest = kernel(stream.data() + first, stream.data() + i + 1).largest;
+                    }
+                });
+        measure("window::push", [&]
+                {
+                    top_two::TSlidingWindow<int32_t> window(window_size);
+                    for (auto value : stream)
+                    {
+                        window.push(value);
+                        [[maybe_unused]] auto volatile largest = window.top_two().largest;
+                    }
+                });
+        measure("window::push_chunk", [&]
+                {
+                    top_two::TSlidingWindow<int32_t> window(window_size);
+                    for (size_t first = 0; first < stream_size; first += chunk_size)
+                    {
+                        window.push(std::span<int32_t const>(stream).subspan(first, std::min(chunk_size, stream_size - first)));
+                        [[maybe_unused]] auto volatile largest = window.top_two().largest;
+                    }
+                });
+    }
+
+    report.write_statistics_csv("results/comparison_of_windows_statistics.csv");
+    report.write_statistics_json("results/comparison_of_windows_statistics.json");
+    return 0;
+}
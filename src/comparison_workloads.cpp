@@ -0,0 +1,61 @@
+// Comparison of all algorithms on all input layouts of workloads.h
+//
+#include <iostream>
+#include <vector>
+
+#include "algorithms.h"
+#include "benchmark.h"
+#include "workloads.h"
+
+int32_t main(int32_t argc, char **argv)
+{
+    const std::vector<size_t> sizes{
+         1'000
+        , 100'000
+        , 1'000'000
+    };
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+
+    std::cout << "Using " << config.n_permutations << " permutations, " << config.n_trials << " trials, "
+              << top_two::benchmark::to_string(config.cache_mode) << " caches\n";
+
+    top_two::benchmark::TReport report(config);
+
+    for (auto workload : top_two::workloads::all)
+    {
+        std::string const workload_name = top_two::workloads::to_string(workload);
+        for (auto size : sizes)
+        {
+            auto const dataset = top_two::workloads::make_dataset(workload, size, config.n_permutations);
+            std::cout << "Workload: " << workload_name << ", " << dataset.size() << " x " << size << " elements\n";
+
+            auto const measure = [&](std::string const &algorithm, auto function)
+            {
+                report.add(algorithm, size, top_two::benchmark::measure(dataset, function, config), workload_name);
+            };
+
+            if (size <= 100'000)
+            {
+                measure("sequential::sort", top_two::sequential::sort<int32_t>);
+            }
+            measure("sequential::nth_element", top_two::sequential::nth_element<int32_t>);
+            measure("sequential::max_element", top_two::sequential::max_element<int32_t>);
+            measure("sequential::max_element_ben_deane", top_two::sequential::max_element_ben_deane<int32_t>);
+            measure("sequential::accumulate", top_two::sequential::accumulate<int32_t>);
+            measure("sequential::accumulate_branchless", top_two::sequential::accumulate_branchless<int32_t>);
+            measure("sequential::accumulate_adaptive", top_two::sequential::accumulate_adaptive<int32_t>);
+            measure("sequential::transform_reduce", top_two::sequential::transform_reduce<int32_t>);
+
+            measure("parallel::sort", top_two::parallel::sort<int32_t>);
+            measure("parallel::nth_element", top_two::parallel::nth_element<int32_t>);
+            measure("parallel::max_element", top_two::parallel::max_element<int32_t>);
+            measure("parallel::max_element_ben_deane", top_two::parallel::max_element_ben_deane<int32_t>);
+            measure("parallel::reduce", top_two::parallel::reduce<int32_t>);
+            measure("parallel::transform_reduce", top_two::parallel::transform_reduce<int32_t>);
+        }
+    }
+
+    report.write_statistics_csv("results/comparison_of_workloads_statistics.csv");
+    report.write_statistics_json("results/comparison_of_workloads_statistics.json");
+    return 0;
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "algorithms.h"
+#include "benchmark.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace top_two
+{
+    // Size-threshold tables that route a call to the variant that was fastest for inputs of that size
+    // on this host. A table is measured once per process and element type, or loaded from the file
+    // named by the environment variable TOP_TWO_CALIBRATION (with the element type appended), and is
+    // written to that file after a calibration. A file that was written on a host with another number
+    // of threads or another instruction set is ignored.
+    namespace tuning
+    {
+        enum class Variant
+        {
+            accumulate_adaptive, // sequential::accumulate_adaptive
+            simd_accumulate,     // sequential simd kernel of the best instruction set
+            pool_reduce,         // parallel::pool::reduce on default_pool()
+            parallel_reduce      // parallel::reduce with std::execution::par_unseq
+        };
+
+        constexpr std::array all_variants{Variant::accumulate_adaptive, Variant::simd_accumulate, Variant::pool_reduce, Variant::parallel_reduce};
+
+        inline char const *to_string(Variant variant)
+        {
+            switch (variant)
+            {
+            case Variant::simd_accumulate:
+                return "simd_accumulate";
+            case Variant::pool_reduce:
+                return "pool_reduce";
+            case Variant::parallel_reduce:
+                return "parallel_reduce";
+            default:
+                return "accumulate_adaptive";
+            }
+        }
+
+        inline std::optional<Variant> variant_from_string(std::string const &name)
+        {
+            for (auto variant : all_variants)
+            {
+                if (name == to_string(variant))
+                {
+                    return variant;
+                }
+            }
+            return std::nullopt;
+        }
+
+        template <typename T>
+        TBasicResult<T> run(Variant variant, std::span<T const> values)
+        {
+            switch (variant)
+            {
+            case Variant::simd_accumulate:
+                return simd::detail::kernel<T>(simd::best_isa())(values.data(), values.data() + values.size());
+            case Variant::pool_reduce:
+                return parallel::pool::reduce<T>(values);
+            case Variant::parallel_reduce:
+                return parallel::reduce<T>(values);
+            default:
+                return sequential::accumulate_adaptive<T>(values);
+            }
+        }
+
+        // Name of the element type in calibration files, e.g. int32 or float64
+        template <typename T>
+        std::string type_name()
+        {
+            std::string const kind = std::is_floating_point_v<T> ? "float" : std::is_signed_v<T> ? "int" : "uint";
+            return kind + std::to_string(8 * sizeof(T));
+        }
+
+        struct TThreshold
+        {
+            size_t min_size; // the variant is used from this size on
+            Variant variant;
+        };
+
+        struct TCalibration
+        {
+            size_t n_threads = 0;
+            simd::Isa isa = simd::Isa::scalar;
+            std::vector<TThreshold> thresholds; // ascending min_size, the first one is 0
+
+            Variant variant_for(size_t size) const
+            {
+                auto const it = std::upper_bound(thresholds.cbegin(), thresholds.cend(), size,
+                                                 [](size_t size, TThreshold const &threshold) { return size < threshold.min_size; });
+                return it == thresholds.cbegin() ? Variant::accumulate_adaptive : std::prev(it)->variant;
+            }
+
+            // Whether the table was measured on a host like this one
+            bool matches_host() const
+            {
+                return n_threads == default_pool().size() && isa == simd::best_isa();
+            }
+        };
+
+        struct TCalibrationConfig
+        {
+            size_t min_size = size_t{1} << 6;
+            size_t max_size = size_t{1} << 22;
+            size_t growth = 4; // factor between consecutive calibration sizes
+            size_t n_trials = 5;
+        };
+
+        // Measures every variant at sizes min_size, min_size * growth, ... up to max_size on random
+        // values and switches to the winner of a size halfway (geometrically) between it and the
+        // previous size.
+        template <typename T>
+        TCalibration calibrate(TCalibrationConfig const &config = {})
+        {
+            TCalibration calibration{default_pool().size(), simd::best_isa(), {}};
+
+            std::vector<T> values(config.max_size);
+            std::mt19937 rng(19937);
+            for (auto &value : values)
+            {
+                value = static_cast<T>(rng());
+            }
+
+            size_t previous_size = 0;
+            for (auto size = config.min_size; size <= config.max_size; size *= config.growth)
+            {
+                std::span<T const> const input{values.data(), size};
+                // calls per trial, so that small sizes are not dominated by the clock resolution
+                auto const n_calls = std::max<size_t>(1, config.min_size * 1'024 / size);
+
+                auto best = Variant::accumulate_adaptive;
+                auto best_median = std::numeric_limits<double>::infinity();
+                for (auto variant : all_variants)
+                {
+                    auto const samples = benchmark::sample([] {},
+                                                           [&]
+                                                           {
+                                                               for (size_t call = 0; call < n_calls; ++call)
+                                                               {
+                                                                   [[maybe_unused]] auto volatile result = run<T>(variant, input).largest;
+                                                               }
+                                                           },
+                                                           1, config.n_trials);
+                    auto const median = benchmark::summarize(samples).median;
+                    if (median < best_median)
+                    {
+                        best = variant;
+                        best_median = median;
+                    }
+                }
+
+                if (calibration.thresholds.empty())
+                {
+                    calibration.thresholds.push_back({0, best});
+                }
+                else if (calibration.thresholds.back().variant != best)
+                {
+                    auto const switch_size = static_cast<size_t>(std::sqrt(static_cast<double>(previous_size) * size));
+                    calibration.thresholds.push_back({switch_size, best});
+                }
+                previous_size = size;
+            }
+            return calibration;
+        }
+
+        // Format: a line "top_two_calibration <type> <threads> <isa>", then one line
+        // "<min_size> <variant>" per threshold
+        template <typename T>
+        bool save(TCalibration const &calibration, std::string const &path)
+        {
+            std::ofstream file(path);
+            file << "top_two_calibration " << type_name<T>() << " " << calibration.n_threads << " " << simd::to_string(calibration.isa) << "\n";
+            for (auto const &threshold : calibration.thresholds)
+            {
+                file << threshold.min_size << " " << to_string(threshold.variant) << "\n";
+            }
+            return static_cast<bool>(file);
+        }
+
+        // Empty if the file does not exist, is malformed or holds a table of another element type
+        template <typename T>
+        std::optional<TCalibration> load(std::string const &path)
+        {
+            std::ifstream file(path);
+            std::string magic, type, isa_name;
+            TCalibration calibration;
+            if (!(file >> magic >> type >> calibration.n_threads >> isa_name) || magic != "top_two_calibration" || type != type_name<T>())
+            {
+                return std::nullopt;
+            }
+
+            auto isa_found = false;
+            for (auto isa : {simd::Isa::scalar, simd::Isa::sse41, simd::Isa::avx2, simd::Isa::avx512})
+            {
+                if (isa_name == simd::to_string(isa))
+                {
+                    calibration.isa = isa;
+                    isa_found = true;
+                }
+            }
+
+            size_t min_size;
+            std::string variant_name;
+            while (file >> min_size >> variant_name)
+            {
+                auto const variant = variant_from_string(variant_name);
+                if (!variant || (!calibration.thresholds.empty() && min_size <= calibration.thresholds.back().min_size))
+                {
+                    return std::nullopt;
+                }
+                calibration.thresholds.push_back({min_size, *variant});
+            }
+            if (!isa_found || calibration.thresholds.empty() || calibration.thresholds.front().min_size != 0)
+            {
+                return std::nullopt;
+            }
+            return calibration;
+        }
+
+        // Table of the element type T, loaded or measured on first use
+        template <typename T>
+        TCalibration const &calibration()
+        {
+            static TCalibration const table = []
+            {
+                auto const path = std::getenv("TOP_TWO_CALIBRATION");
+                if (!path)
+                {
+                    return calibrate<T>();
+                }
+
+                auto const file = std::string(path) + "." + type_name<T>();
+                if (auto loaded = load<T>(file); loaded && loaded->matches_host())
+                {
+                    return *loaded;
+                }
+                auto measured = calibrate<T>();
+                save<T>(measured, file);
+                return measured;
+            }();
+            return table;
+        }
+    }
+
+    // Top two with the variant that was fastest for inputs of this size on this host, see tuning.
+    template <typename T = int32_t>
+    TBasicResult<T> dispatch(std::span<T const> values)
+    {
+        return tuning::run<T>(tuning::calibration<T>().variant_for(values.size()), values);
+    }
+}
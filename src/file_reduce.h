@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <future>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "accumulator.h"
+#include "algorithms.h"
+
+namespace top_two
+{
+    // Top two of a file of raw values in native byte order, e.g. int32 or int64, without loading the
+    // whole file into memory. Trailing bytes that do not form a complete value are ignored. I/O errors
+    // are thrown as std::system_error.
+    namespace file
+    {
+        enum class IoMode
+        {
+            mmap, // the file is mapped and reduced in place, the kernel reads ahead
+            pread // blocks are read into two buffers, the next block is read while the current one is reduced
+        };
+
+        struct TFileConfig
+        {
+            IoMode mode = IoMode::mmap;
+            size_t block_size = size_t{8} << 20; // bytes, rounded down to whole values
+        };
+
+        namespace detail
+        {
+            // Closes the descriptor at the end of a reduction
+            class TFile
+            {
+            public:
+                explicit TFile(std::string const &path, int flags = O_RDONLY) : fd(::open(path.c_str(), flags | O_CLOEXEC, 0644))
+                {
+                    if (fd < 0)
+                    {
+                        throw std::system_error(errno, std::generic_category(), "open " + path);
+                    }
+                }
+
+                ~TFile() { ::close(fd); }
+
+                TFile(TFile const &) = delete;
+                TFile &operator=(TFile const &) = delete;
+
+                size_t size() const
+                {
+                    struct stat status;
+                    if (::fstat(fd, &status) != 0)
+                    {
+                        throw std::system_error(errno, std::generic_category(), "fstat");
+                    }
+                    return static_cast<size_t>(status.st_size);
+                }
+
+                // Reads up to size bytes at offset, fewer only at the end of the file
+                size_t read(void *buffer, size_t size, size_t offset) const
+                {
+                    size_t done = 0;
+                    while (done < size)
+                    {
+                        auto const n = ::pread(fd, static_cast<char *>(buffer) + done, size - done, static_cast<off_t>(offset + done));
+                        if (n < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (n < 0)
+                        {
+                            throw std::system_error(errno, std::generic_category(), "pread");
+                        }
+                        if (n == 0)
+                        {
+                            break;
+                        }
+                        done += static_cast<size_t>(n);
+                    }
+                    return done;
+                }
+
+                // Writes all size bytes at offset
+                void write(void const *buffer, size_t size, size_t offset) const
+                {
+                    size_t done = 0;
+                    while (done < size)
+                    {
+                        auto const n = ::pwrite(fd, static_cast<char const *>(buffer) + done, size - done, static_cast<off_t>(offset + done));
+                        if (n < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+                        if (n < 0)
+                        {
+                            throw std::system_error(errno, std::generic_category(), "pwrite");
+                        }
+                        done += static_cast<size_t>(n);
+                    }
+                }
+
+                int descriptor() const { return fd; }
+
+            private:
+                int fd;
+            };
+
+            template <typename T>
+            size_t values_per_block(TFileConfig const &config)
+            {
+                return std::max<size_t>(1, config.block_size / sizeof(T));
+            }
+
+            template <typename T>
+            TBasicResult<T> reduce_mmap(TFile const &file, TFileConfig const &config)
+            {
+                auto const n_values = file.size() / sizeof(T);
+                if (n_values == 0)
+                {
+                    return {};
+                }
+
+                auto const length = n_values * sizeof(T);
+                auto const address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file.descriptor(), 0);
+                if (address == MAP_FAILED)
+                {
+                    throw std::system_error(errno, std::generic_category(), "mmap");
+                }
+                ::madvise(address, length, MADV_SEQUENTIAL);
+
+                std::span<T const> const values{static_cast<T const *>(address), n_values};
+                auto const block = values_per_block<T>(config);
+                TopTwoAccumulator<T> accumulator;
+                for (size_t first = 0; first < n_values; first += block)
+                {
+                    auto const next = first + block;
+                    if (next < n_values)
+                    {
+                        // page aligned start of the next block
+                        auto const page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+                        auto const offset = next * sizeof(T) / page * page;
+                        ::madvise(static_cast<char *>(address) + offset, std::min(block * sizeof(T), length - offset), MADV_WILLNEED);
+                    }
+                    accumulator.push(values.subspan(first, std::min(block, n_values - first)));
+                }
+
+                ::munmap(address, length);
+                return accumulator.result();
+            }
+
+            template <typename T>
+            TBasicResult<T> reduce_pread(TFile const &file, TFileConfig const &config)
+            {
+                ::posix_fadvise(file.descriptor(), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+                auto const block = values_per_block<T>(config);
+                std::vector<T> current(block), next(block);
+                auto const read_block = [&file, block](T *buffer, size_t offset)
+                {
+                    return file.read(buffer, block * sizeof(T), offset) / sizeof(T);
+                };
+
+                TopTwoAccumulator<T> accumulator;
+                size_t offset = 0;
+                auto n_current = read_block(current.data(), offset);
+                while (n_current == block)
+                {
+                    offset += block * sizeof(T);
+                    auto pending = std::async(std::launch::async, read_block, next.data(), offset);
+                    accumulator.push(std::span<T const>{current.data(), n_current});
+                    n_current = pending.get();
+                    std::swap(current, next);
+                }
+                accumulator.push(std::span<T const>{current.data(), n_current});
+                return accumulator.result();
+            }
+        }
+
+        template <typename T = int32_t>
+        TBasicResult<T> reduce(std::string const &path, TFileConfig const &config = {})
+        {
+            detail::TFile const file(path);
+            return config.mode == IoMode::mmap ? detail::reduce_mmap<T>(file, config) : detail::reduce_pread<T>(file, config);
+        }
+
+        // Reads the whole file block by block without reducing it, the baseline for the I/O modes.
+        // Returns the number of bytes read.
+        inline size_t read_all(std::string const &path, TFileConfig const &config = {})
+        {
+            detail::TFile const file(path);
+            ::posix_fadvise(file.descriptor(), 0, 0, POSIX_FADV_SEQUENTIAL);
+            std::vector<char> buffer(std::max<size_t>(1, config.block_size));
+            size_t offset = 0;
+            while (auto const n = file.read(buffer.data(), buffer.size(), offset))
+            {
+                offset += n;
+            }
+            return offset;
+        }
+
+        // Drops the cached pages of a file, so that the next read comes from the storage device.
+        // Pages that are mapped or dirty stay cached.
+        inline void evict(std::string const &path)
+        {
+            detail::TFile const file(path);
+            ::posix_fadvise(file.descriptor(), 0, 0, POSIX_FADV_DONTNEED);
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "algorithms.h"
+#include "simd.h"
+
+namespace top_two
+{
+    namespace detail
+    {
+        // Inputs up to this size are reduced by the comparator network, larger ones by
+        // accumulate_branchless
+        constexpr size_t max_network_size = 256;
+
+        // Integral inputs of at least this many bytes are reduced in the lanes of 16-byte vectors,
+        // and from min_avx2_bytes on in 32-byte vectors if the host has AVX2. Smaller inputs do not
+        // pay for the horizontal merge of the lanes. AVX-512 is slower at all of these sizes because
+        // of its wider merge and the warm-up of the 512-bit units.
+        constexpr size_t min_lanes_bytes = 64;
+        constexpr size_t min_avx2_bytes = 256;
+
+        template <typename T, typename Compare>
+        constexpr T larger(T lhs, T rhs)
+        {
+            return Compare{}(lhs, rhs) ? rhs : lhs;
+        }
+
+        template <typename T, typename Compare>
+        constexpr T smaller(T lhs, T rhs)
+        {
+            return Compare{}(lhs, rhs) ? lhs : rhs;
+        }
+
+        template <typename T, typename Compare>
+        constexpr TBasicResult<T, Compare> merge_network(TBasicResult<T, Compare> lhs, TBasicResult<T, Compare> rhs)
+        {
+            return {larger<T, Compare>(smaller<T, Compare>(lhs.largest, rhs.largest), larger<T, Compare>(lhs.second_largest, rhs.second_largest)),
+                    larger<T, Compare>(lhs.largest, rhs.largest)};
+        }
+
+        // Top two of values[First, Last) as a tree of selects whose shape is fixed at compile time:
+        // the leaves compare two neighbouring values, and every inner node merges the top two of its
+        // halves with
+        //   largest        = max(lhs.largest, rhs.largest)
+        //   second_largest = max(min(lhs.largest, rhs.largest), max(lhs.second_largest, rhs.second_largest))
+        // There is no loop and no branch on the data. The halves are independent, so the selects of
+        // one level of the tree can execute in parallel or be vectorized.
+        template <size_t First, size_t Last, typename T, typename Compare>
+        constexpr TBasicResult<T, Compare> network(T const *values)
+        {
+            if constexpr (Last - First == 0)
+            {
+                return {};
+            }
+            else if constexpr (Last - First == 1)
+            {
+                return {Compare::lowest(), values[First]};
+            }
+            else if constexpr (Last - First == 2)
+            {
+                return {smaller<T, Compare>(values[First], values[First + 1]), larger<T, Compare>(values[First], values[First + 1])};
+            }
+            else
+            {
+                // the left half is a power of two, so that all leaves but the last one are pairs
+                constexpr auto half = std::bit_floor(Last - First - 1);
+                return merge_network(network<First, First + half, T, Compare>(values), network<First + half, Last, T, Compare>(values));
+            }
+        }
+
+        // The network with the values in the lanes of 16-byte vectors, which every x86-64 CPU has.
+        // Every lane of n_chains independent pairs of vectors keeps the top two of its share of the
+        // values, so consecutive vectors do not wait for each other. The chains and then the lanes
+        // are merged at the end, and the values that do not fill a vector are reduced by network.
+        // The loops have constant trip counts and are unrolled. Integral values under Less or
+        // Greater only, whose order the vector comparisons implement.
+        template <size_t N, typename T, typename Compare, size_t NBytes = 16>
+        __attribute__((always_inline)) inline TBasicResult<T, Compare> network_lanes(T const *values)
+        {
+            typedef T TVector __attribute__((vector_size(NBytes)));
+            constexpr size_t n_lanes = NBytes / sizeof(T);
+            constexpr size_t n_vectors = N / n_lanes;
+            constexpr size_t n_chains = std::min<size_t>(4, n_vectors);
+            // the vector comparisons take lhs < rhs of Less<T>, and rhs < lhs of Greater<T>
+            constexpr bool reversed = std::is_same_v<Compare, Greater<T>>;
+
+            TVector largest[n_chains], second_largest[n_chains];
+#pragma GCC unroll 4
+            for (size_t c = 0; c < n_chains; ++c)
+            {
+                std::memcpy(&largest[c], values + c * n_lanes, sizeof(TVector));
+                second_largest[c] = TVector{} + Compare::lowest();
+            }
+#pragma GCC unroll 64
+            for (size_t i = n_chains; i < n_vectors; ++i)
+            {
+                auto const c = i % n_chains;
+                TVector v;
+                std::memcpy(&v, values + i * n_lanes, sizeof(v));
+                auto const low = (reversed ? largest[c] < v : v < largest[c]) ? v : largest[c];
+                second_largest[c] = (reversed ? low < second_largest[c] : second_largest[c] < low) ? low : second_largest[c];
+                largest[c] = (reversed ? v < largest[c] : largest[c] < v) ? v : largest[c];
+            }
+#pragma GCC unroll 4
+            for (size_t c = 1; c < n_chains; ++c)
+            {
+                auto const low = (reversed ? largest[0] < largest[c] : largest[c] < largest[0]) ? largest[c] : largest[0];
+                auto const second = (reversed ? second_largest[0] < second_largest[c] : second_largest[c] < second_largest[0]) ? second_largest[0] : second_largest[c];
+                second_largest[0] = (reversed ? low < second : second < low) ? low : second;
+                largest[0] = (reversed ? largest[c] < largest[0] : largest[0] < largest[c]) ? largest[c] : largest[0];
+            }
+
+            auto result = network<n_vectors * n_lanes, N, T, Compare>(values);
+#pragma GCC unroll 16
+            for (size_t lane = 0; lane < n_lanes; ++lane)
+            {
+                result = merge_network(result, TBasicResult<T, Compare>{second_largest[0][lane], largest[0][lane]});
+            }
+            return result;
+        }
+
+#ifdef TOP_TWO_SIMD_X86
+        template <size_t N, typename T, typename Compare>
+        __attribute__((target("avx2"))) TBasicResult<T, Compare> network_avx2(T const *values)
+        {
+            return network_lanes<N, T, Compare, 32>(values);
+        }
+#endif
+    }
+
+    // Top two of inputs whose size is known at compile time, e.g. per-request feature vectors. Up
+    // to detail::max_network_size values they are reduced by detail::network, which needs no loop,
+    // copy or size check and can be evaluated at compile time. These are not overloads of
+    // sequential::accumulate, so that sequential::accumulate<T> still names a single function that
+    // can be passed to the benchmarks.
+    namespace fixed_size
+    {
+        template <typename T = int32_t, typename Compare = Less<T>, size_t N>
+            requires(N != std::dynamic_extent)
+        constexpr TBasicResult<T, Compare> accumulate(std::span<T const, N> values)
+        {
+            if constexpr (N <= detail::max_network_size)
+            {
+                if constexpr (std::is_integral_v<T> && (std::is_same_v<Compare, Less<T>> || std::is_same_v<Compare, Greater<T>>) &&
+                              N * sizeof(T) >= detail::min_lanes_bytes)
+                {
+                    if (!std::is_constant_evaluated())
+                    {
+#ifdef TOP_TWO_SIMD_X86
+                        if (N * sizeof(T) >= detail::min_avx2_bytes && simd::is_supported(simd::Isa::avx2))
+                        {
+                            return detail::network_avx2<N, T, Compare>(values.data());
+                        }
+#endif
+                        return detail::network_lanes<N, T, Compare>(values.data());
+                    }
+                }
+                return detail::finish(detail::network<0, N, T, Compare>(values.data()));
+            }
+            else
+            {
+                return sequential::accumulate_branchless<T, Compare>(std::span<T const>(values));
+            }
+        }
+
+        template <typename T = int32_t, typename Compare = Less<T>, size_t N>
+        constexpr TBasicResult<T, Compare> accumulate(std::array<T, N> const &values)
+        {
+            return accumulate<T, Compare, N>(std::span<T const, N>(values));
+        }
+    }
+}
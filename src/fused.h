@@ -0,0 +1,356 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "algorithms.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace top_two
+{
+    // Several statistics of the same values in one pass, e.g.
+    //   auto const stats = fused::sequential::accumulate<int32_t, fused::Min, fused::Sum, fused::TopTwo>(values);
+    //   stats.get<fused::TopTwo>().largest
+    // The input is read block by block. Every statistic folds a block while it is in the L1 cache,
+    // so each value is loaded from memory once however many statistics are computed, and the loop
+    // of every statistic is vectorized on its own.
+    //
+    // A statistic is a type with the members
+    //   template <typename T> using TState          partial result
+    //   template <typename T> static TState<T> init()
+    //   template <typename T> static void accumulate(TState<T> &state, T const *first, T const *last)
+    //   template <typename T> static void merge(TState<T> &state, TState<T> const &other)
+    //   template <typename T> static auto finish(TState<T> const &state)
+    namespace fused
+    {
+        // Smallest value, Greater<T>::lowest() of an empty input. NaN is ignored.
+        struct Min
+        {
+            template <typename T>
+            using TState = T;
+
+            template <typename T>
+            static T init() { return Greater<T>::lowest(); }
+
+            template <typename T>
+            static void accumulate(T &state, T const *first, T const *last)
+            {
+                Greater<T> const greater;
+                auto result = state;
+                for (; first != last; ++first)
+                {
+                    result = greater(result, *first) ? *first : result;
+                }
+                state = result;
+            }
+
+            template <typename T>
+            static void merge(T &state, T const &other) { accumulate(state, &other, &other + 1); }
+
+            template <typename T>
+            static T finish(T const &state) { return state; }
+        };
+
+        // Largest value, Less<T>::lowest() of an empty input. NaN is ignored.
+        struct Max
+        {
+            template <typename T>
+            using TState = T;
+
+            template <typename T>
+            static T init() { return Less<T>::lowest(); }
+
+            template <typename T>
+            static void accumulate(T &state, T const *first, T const *last)
+            {
+                Less<T> const less;
+                auto result = state;
+                for (; first != last; ++first)
+                {
+                    result = less(result, *first) ? *first : result;
+                }
+                state = result;
+            }
+
+            template <typename T>
+            static void merge(T &state, T const &other) { accumulate(state, &other, &other + 1); }
+
+            template <typename T>
+            static T finish(T const &state) { return state; }
+        };
+
+        // Sum in int64_t, uint64_t or double, so that it does not overflow the element type
+        struct Sum
+        {
+            template <typename T>
+            using TState = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+            template <typename T>
+            static TState<T> init() { return 0; }
+
+            template <typename T>
+            static void accumulate(TState<T> &state, T const *first, T const *last)
+            {
+                state = std::accumulate(first, last, state);
+            }
+
+            template <typename T>
+            static void merge(TState<T> &state, TState<T> const &other) { state += other; }
+
+            template <typename T>
+            static TState<T> finish(TState<T> const &state) { return state; }
+        };
+
+        struct Count
+        {
+            template <typename T>
+            using TState = size_t;
+
+            template <typename T>
+            static size_t init() { return 0; }
+
+            template <typename T>
+            static void accumulate(size_t &state, T const *first, T const *last) { state += static_cast<size_t>(last - first); }
+
+            template <typename T>
+            static void merge(size_t &state, size_t const &other) { state += other; }
+
+            template <typename T>
+            static size_t finish(size_t const &state) { return state; }
+        };
+
+        namespace detail
+        {
+            // Top two of integral values under Less or Greater with one vector of 64 bytes per value
+            // of the result, like batch::detail::accumulate_group. The vector is split into the
+            // registers of the instruction set that the caller is compiled for.
+            template <typename T, typename Compare>
+            __attribute__((always_inline)) inline TBasicResult<T, Compare> accumulate_lanes(TBasicResult<T, Compare> state, T const *first, T const *last)
+            {
+                typedef T TVector __attribute__((vector_size(64)));
+                constexpr size_t n_lanes = 64 / sizeof(T);
+                constexpr bool reversed = std::is_same_v<Compare, Greater<T>>;
+
+                auto const lowest = TVector{} + Compare::lowest();
+                TVector largest = lowest, second_largest = lowest;
+                for (; first + n_lanes <= last; first += n_lanes)
+                {
+                    TVector v;
+                    std::memcpy(&v, first, sizeof(v));
+                    auto const low = (reversed ? largest < v : v < largest) ? v : largest;
+                    second_largest = (reversed ? low < second_largest : second_largest < low) ? low : second_largest;
+                    largest = (reversed ? v < largest : largest < v) ? v : largest;
+                }
+
+                top_two::parallel::ReduceOp<T, Compare> merge;
+                for (size_t lane = 0; lane < n_lanes; ++lane)
+                {
+                    state = merge(state, TBasicResult<T, Compare>{second_largest[lane], largest[lane]});
+                }
+                for (; first != last; ++first)
+                {
+                    state = merge(state, *first);
+                }
+                return state;
+            }
+        }
+
+        // Largest and second largest value in the order of TCompare<T>. Blocks are reduced by the simd
+        // kernel if one exists for the element type and comparator, integral values under Greater by
+        // accumulate_lanes. Partial results are merged with ReduceOp.
+        template <template <typename, NanPolicy> class TCompare, NanPolicy Policy = NanPolicy::ignore>
+        struct TTopTwo
+        {
+            template <typename T>
+            using TState = TBasicResult<T, TCompare<T, Policy>>;
+
+            template <typename T>
+            static TState<T> init() { return {}; }
+
+            template <typename T>
+            static void accumulate(TState<T> &state, T const *first, T const *last)
+            {
+                if constexpr (std::is_same_v<TCompare<T, Policy>, Less<T>>)
+                {
+                    state = top_two::parallel::ReduceOp<T>{}(state, simd::detail::kernel<T>(simd::best_isa())(first, last));
+                }
+                else if constexpr (std::is_integral_v<T> && std::is_same_v<TCompare<T, Policy>, Greater<T>>)
+                {
+                    state = detail::accumulate_lanes<T, TCompare<T, Policy>>(state, first, last);
+                }
+                else
+                {
+                    state = top_two::detail::accumulate_branchless<T, TCompare<T, Policy>>(std::span<T const>(first, last), state);
+                }
+            }
+
+            template <typename T>
+            static void merge(TState<T> &state, TState<T> const &other)
+            {
+                state = top_two::parallel::ReduceOp<T, TCompare<T, Policy>>{}(state, other);
+            }
+
+            template <typename T>
+            static TState<T> finish(TState<T> const &state) { return top_two::detail::finish(state); }
+        };
+
+        using TopTwo = TTopTwo<Less>;
+
+        // Smallest and second smallest value
+        using BottomTwo = TTopTwo<Greater>;
+
+        namespace detail
+        {
+            // Values per block, small enough that a block stays in the L1 cache while all
+            // statistics fold it
+            constexpr size_t block_size = 2'048;
+
+            // Elements per task of the parallel algorithms, see simd::detail::chunk_size
+            constexpr size_t chunk_size = size_t{1} << 16;
+
+            template <typename Stat, typename... Stats>
+            constexpr size_t index_of()
+            {
+                constexpr bool matches[] = {std::is_same_v<Stat, Stats>...};
+                for (size_t i = 0; i < sizeof...(Stats); ++i)
+                {
+                    if (matches[i])
+                    {
+                        return i;
+                    }
+                }
+                return sizeof...(Stats);
+            }
+        }
+
+        // The partial results of the statistics Stats of values of type T
+        template <typename T, typename... Stats>
+        class TFused
+        {
+        public:
+            TFused() : states(Stats::template init<T>()...) {}
+
+            // The block loop is compiled for every instruction set of simd::Isa and called for the
+            // widest one of the host, so that the loops of the statistics use its full vector width
+            void push(std::span<T const> values)
+            {
+                switch (simd::best_isa())
+                {
+#ifdef TOP_TWO_SIMD_X86
+                case simd::Isa::avx512:
+                    return push_avx512(values);
+                case simd::Isa::avx2:
+                    return push_avx2(values);
+                case simd::Isa::sse41:
+                    return push_sse41(values);
+#endif
+                default:
+                    return push_blocks(values);
+                }
+            }
+
+            TFused &merge(TFused const &other)
+            {
+                merge_states(other, std::index_sequence_for<Stats...>{});
+                return *this;
+            }
+
+            // The final result of one of the statistics
+            template <typename Stat>
+            auto get() const
+            {
+                constexpr auto index = detail::index_of<Stat, Stats...>();
+                static_assert(index < sizeof...(Stats), "the statistic is not part of this TFused");
+                return Stat::template finish<T>(std::get<index>(states));
+            }
+
+        private:
+            __attribute__((always_inline)) inline void push_blocks(std::span<T const> values)
+            {
+                for (size_t first = 0; first < values.size(); first += detail::block_size)
+                {
+                    auto const block_first = values.data() + first;
+                    auto const block_last = values.data() + std::min(values.size(), first + detail::block_size);
+                    std::apply([&](auto &...state) { (Stats::template accumulate<T>(state, block_first, block_last), ...); }, states);
+                }
+            }
+
+#ifdef TOP_TWO_SIMD_X86
+            // flatten inlines the statistics into the function, which compiles them for its target
+            __attribute__((target("sse4.1"), flatten)) void push_sse41(std::span<T const> values) { push_blocks(values); }
+            __attribute__((target("avx2"), flatten)) void push_avx2(std::span<T const> values) { push_blocks(values); }
+            __attribute__((target("avx512f,avx512bw"), flatten)) void push_avx512(std::span<T const> values) { push_blocks(values); }
+#endif
+
+            template <size_t... Is>
+            void merge_states(TFused const &other, std::index_sequence<Is...>)
+            {
+                (Stats::template merge<T>(std::get<Is>(states), std::get<Is>(other.states)), ...);
+            }
+
+            std::tuple<typename Stats::template TState<T>...> states;
+        };
+
+        namespace detail
+        {
+            template <typename T, typename... Stats>
+            struct MergeOp
+            {
+                TFused<T, Stats...> operator()(TFused<T, Stats...> lhs, TFused<T, Stats...> const &rhs) const
+                {
+                    return lhs.merge(rhs);
+                }
+            };
+        }
+
+        namespace sequential
+        {
+            template <typename T = int32_t, typename... Stats>
+            TFused<T, Stats...> accumulate(std::span<T const> values)
+            {
+                TFused<T, Stats...> result;
+                result.push(values);
+                return result;
+            }
+        }
+
+        namespace parallel
+        {
+            // Like simd::reduce: the chunks of the input are reduced into their partial results on
+            // the Backend, which is passed as a tag because Stats takes all explicit template
+            // arguments, e.g. transform_reduce<int32_t, fused::Min, fused::Max>(values, backend::Threads{})
+            template <typename T = int32_t, typename... Stats, typename Backend = backend::Std<std::execution::parallel_policy>>
+            TFused<T, Stats...> transform_reduce(std::span<T const> values, Backend = {})
+            {
+                auto const n_chunks = (values.size() + detail::chunk_size - 1) / detail::chunk_size;
+
+                auto const reduce_chunk = [values](size_t chunk)
+                {
+                    auto const first = chunk * detail::chunk_size;
+                    return sequential::accumulate<T, Stats...>(values.subspan(first, std::min(values.size() - first, detail::chunk_size)));
+                };
+
+                return Backend::reduce_chunks(n_chunks, TFused<T, Stats...>{}, detail::MergeOp<T, Stats...>{}, reduce_chunk);
+            }
+
+            // On the threads of a TThreadPool, see top_two::parallel::pool::reduce
+            template <typename T = int32_t, typename... Stats>
+            TFused<T, Stats...> reduce(std::span<T const> values, TThreadPool &pool = default_pool())
+            {
+                auto const reduce_block = [values](size_t first, size_t last)
+                {
+                    return sequential::accumulate<T, Stats...>(values.subspan(first, last - first));
+                };
+                return pool.reduce(values.size(), TFused<T, Stats...>{}, reduce_block, detail::MergeOp<T, Stats...>{});
+            }
+        }
+    }
+}
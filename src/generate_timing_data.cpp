@@ -1,18 +1,23 @@
-#include <chrono>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <random>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "algorithms.h"
+#include "benchmark.h"
+#include "dispatch.h"
+#include "load_generator.h"
+#include "simd.h"
+#include "thread_pool.h"
 
 namespace top_two
 {
-    constexpr static auto duration_in_ms = [](auto start, auto end) -> double
-    {
-        return std::chrono::duration<double, std::micro>(end - start).count();
-    };
-
     using TTimingData = std::vector<double>;
 
     auto make_data(size_t size)
@@ -22,55 +27,172 @@ namespace top_two
         return data;
     }
 
+    // Execution times in us of config.n_permutations calls, every call on a fresh permutation
     template<typename F>
-    TTimingData generate_data(size_t size, size_t n_permutations, F algorithm)
+    TTimingData generate_data(size_t size, benchmark::TConfig const &config, F algorithm, benchmark::TCounterValues &counters)
     {
         std::mt19937 rng(19937);
         auto data = make_data(size);
 
-        TTimingData timing_data(n_permutations);
-
-        for (auto& timing : timing_data)
+        auto const setup = [&]
         {
             std::shuffle(data.begin(), data.end(), rng);
-            
-            auto const start = std::chrono::high_resolution_clock::now();
-            auto volatile res = algorithm(data);
-            auto const end = std::chrono::high_resolution_clock::now();
+            if (config.cache_mode == benchmark::CacheMode::cold)
+            {
+                benchmark::cache_flusher(config.flush_size).flush();
+            }
+        };
+        auto const perf_counters = benchmark::perf_counters(config);
+        auto timing_data = benchmark::sample(setup, [&] { [[maybe_unused]] auto volatile res = algorithm(data); }, config.n_warmup, config.n_permutations, perf_counters);
+        if (perf_counters)
+        {
+            counters = perf_counters->read() / config.n_permutations;
+        }
+        for (auto &timing : timing_data)
+        {
+            timing *= 1'000.0;
+        }
+        return timing_data;
+    }
 
-            timing = duration_in_ms(start, end);
+    // Load generator mode: --load [--algorithm NAME] [--size N] [--clients N] [--qps Q] [--duration MS]
+    // All clients query the same shuffled vector. Without --clients, the number of clients is swept
+    // from 1 to twice the number of hardware threads. Without --qps, every client sends its next
+    // request as soon as the previous one returned.
+    int32_t generate_load(int32_t argc, char **argv)
+    {
+        std::string algorithm = "parallel::reduce";
+        size_t size = 1'000'000;
+        std::vector<size_t> client_counts;
+        benchmark::TLoadConfig load_config;
+        for (int32_t i = 1; i + 1 < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--algorithm") == 0)
+            {
+                algorithm = argv[i + 1];
+            }
+            else if (std::strcmp(argv[i], "--size") == 0)
+            {
+                size = std::stoul(argv[i + 1]);
+            }
+            else if (std::strcmp(argv[i], "--clients") == 0)
+            {
+                client_counts.push_back(std::stoul(argv[i + 1]));
+            }
+            else if (std::strcmp(argv[i], "--qps") == 0)
+            {
+                load_config.target_qps = std::stod(argv[i + 1]);
+            }
+            else if (std::strcmp(argv[i], "--duration") == 0)
+            {
+                load_config.duration = std::chrono::milliseconds(std::stoul(argv[i + 1]));
+            }
+        }
+        if (client_counts.empty())
+        {
+            for (size_t n_clients = 1; n_clients <= 2 * std::max(1u, std::thread::hardware_concurrency()); n_clients *= 2)
+            {
+                client_counts.push_back(n_clients);
+            }
         }
 
-        return timing_data;
+        using TQuery = std::function<TResult(std::span<int32_t const>)>;
+        std::map<std::string, TQuery> const queries{
+            {"sequential::accumulate", sequential::accumulate<int32_t>},
+            {"sequential::accumulate_adaptive", sequential::accumulate_adaptive<int32_t>},
+            {"parallel::reduce", [](std::span<int32_t const> values) { return parallel::reduce<int32_t>(values); }},
+            {"parallel::pool::reduce", [](std::span<int32_t const> values) { return parallel::pool::reduce<int32_t>(values); }},
+            {"simd::accumulate", [](std::span<int32_t const> values) { return simd::detail::kernel<int32_t>(simd::best_isa())(values.data(), values.data() + values.size()); }},
+            {"dispatch", [](std::span<int32_t const> values) { return dispatch<int32_t>(values); }}};
+        auto const query = queries.find(algorithm);
+        if (query == queries.cend())
+        {
+            std::cout << "Unknown algorithm " << algorithm << ", one of:";
+            for (auto const &[name, function] : queries)
+            {
+                std::cout << " " << name;
+            }
+            std::cout << "\n";
+            return 1;
+        }
+
+        auto const values = make_dataset(size, 1).front();
+        std::ofstream statistics("results/load_statistics.csv");
+        statistics << "algorithm,size,n_clients,target_qps,duration_s,n_requests,throughput_qps,mean_us,p50_us,p90_us,p99_us,p99_9_us,max_us\n";
+        std::ofstream distribution("results/load_latency_distribution.csv");
+        distribution << "n_clients,percentile,latency_us\n";
+
+        for (auto n_clients : client_counts)
+        {
+            load_config.n_clients = n_clients;
+            auto const result = benchmark::run_load(load_config, [&](size_t)
+                                                    {
+                                                        [[maybe_unused]] auto volatile largest = query->second(values).largest;
+                                                    });
+            auto const &latencies = result.latencies;
+            auto const us = [&latencies](double percentile) { return latencies.value_at_percentile(percentile) * 1e-3; };
+
+            std::cout << algorithm << ", " << n_clients << " clients: " << result.throughput() << " queries/s, p50 " << us(50.0)
+                      << " us, p99 " << us(99.0) << " us, p99.9 " << us(99.9) << " us\n";
+            statistics << algorithm << "," << size << "," << n_clients << "," << load_config.target_qps << "," << result.duration_s << ","
+                       << result.n_requests << "," << result.throughput() << "," << latencies.mean() * 1e-3 << "," << us(50.0) << ","
+                       << us(90.0) << "," << us(99.0) << "," << us(99.9) << "," << latencies.max() * 1e-3 << "\n";
+            for (double percentile : {0.0, 10.0, 25.0, 50.0, 75.0, 90.0, 95.0, 99.0, 99.5, 99.9, 99.95, 99.99, 100.0})
+            {
+                distribution << n_clients << "," << percentile << "," << us(percentile) << "\n";
+            }
+        }
+        return 0;
     }
 }
 
-int32_t main()
+int32_t main(int32_t argc, char **argv)
 {
-    std::mt19937 rng(19937);
+    if (std::find_if(argv + 1, argv + argc, [](char const *arg) { return std::strcmp(arg, "--load") == 0; }) != argv + argc)
+    {
+        return top_two::generate_load(argc, argv);
+    }
 
-    const size_t n_permutations = 1'000;
-    std::cout << "Using " << n_permutations << " permutations\n";
+    auto const config = top_two::benchmark::parse_config(argc, argv);
+    std::cout << "Using " << config.n_permutations << " permutations, " << top_two::benchmark::to_string(config.cache_mode) << " caches\n";
 
-    auto timing_sort                    = top_two::generate_data(100'000,       n_permutations, top_two::sort);
-    auto timing_nth_element             = top_two::generate_data(1'000'000,     n_permutations, top_two::nth_element);
-    auto timing_max_element             = top_two::generate_data(10'000'000,    n_permutations, top_two::max_element);
-    auto timing_max_element_ben_deane   = top_two::generate_data(10'000'000,    n_permutations, top_two::max_element_ben_deane);
-    auto timing_accumulate              = top_two::generate_data(10'000'000,   n_permutations, top_two::accumulate);
-    auto timing_transform_reduce        = top_two::generate_data(10'000'000,   n_permutations, top_two::transform_reduce);
+    const std::vector<std::string> algorithms{"sort", "nth_element", "max_element", "max_element_ben_deane", "accumulate", "transform_reduce"};
+    const std::vector<size_t> sizes{100'000, 1'000'000, 10'000'000, 10'000'000, 10'000'000, 10'000'000};
+    std::vector<top_two::benchmark::TCounterValues> counters(algorithms.size());
+    const std::vector<top_two::TTimingData> timings{
+        top_two::generate_data(sizes[0], config, top_two::sequential::sort<int32_t>, counters[0])
+        , top_two::generate_data(sizes[1], config, top_two::sequential::nth_element<int32_t>, counters[1])
+        , top_two::generate_data(sizes[2], config, top_two::sequential::max_element<int32_t>, counters[2])
+        , top_two::generate_data(sizes[3], config, top_two::sequential::max_element_ben_deane<int32_t>, counters[3])
+        , top_two::generate_data(sizes[4], config, top_two::sequential::accumulate<int32_t>, counters[4])
+        , top_two::generate_data(sizes[5], config, top_two::sequential::transform_reduce<int32_t>, counters[5])
+    };
 
     std::ofstream timing_data("results/timing_data.csv");
     timing_data << "sort, nth_element, max_element, max_element_ben_deane, accumulate, transform_reduce\n";
-    for (size_t i = 0; i < n_permutations; ++i)
+    for (size_t i = 0; i < config.n_permutations; ++i)
     {
-        timing_data
-            << timing_sort[i] << ","
-            << timing_nth_element[i] << ","
-            << timing_max_element[i] << ","
-            << timing_max_element_ben_deane[i] << ","
-            << timing_accumulate[i] << ","
-            << timing_transform_reduce[i] << "\n";
+        for (size_t a = 0; a < timings.size(); ++a)
+        {
+            timing_data << timings[a][i] << (a + 1 < timings.size() ? "," : "\n");
+        }
+    }
+
+    top_two::benchmark::TReport report(config);
+    for (size_t a = 0; a < timings.size(); ++a)
+    {
+        auto samples_in_ms = timings[a];
+        for (auto &sample : samples_in_ms)
+        {
+            sample /= 1'000.0;
+        }
+        auto statistics = top_two::benchmark::summarize(samples_in_ms);
+        statistics.bandwidth = sizes[a] * sizeof(int32_t) / statistics.median * 1e-6;
+        statistics.counters = counters[a];
+        report.add(algorithms[a], sizes[a], statistics);
     }
+    report.write_statistics_csv("results/timing_data_statistics.csv");
+    report.write_statistics_json("results/timing_data_statistics.json");
 
     return 0;
-}
\ No newline at end of file
+}
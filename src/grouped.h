@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "algorithms.h"
+#include "thread_pool.h"
+
+namespace top_two
+{
+    // Top two per key of (key, value) pairs that are given as two columns of equal length, like
+    // SELECT key, top_two(value) ... GROUP BY key. The result holds one entry per distinct key in an
+    // unspecified order.
+    namespace grouped
+    {
+        template <typename TKey, typename T = int32_t, typename Compare = Less<T>>
+        struct TGroups
+        {
+            std::vector<TKey> keys;
+            std::vector<TBasicResult<T, Compare>> results; // results[i] belongs to keys[i]
+
+            size_t size() const { return keys.size(); }
+        };
+
+        namespace detail
+        {
+            // Multiplicative (Fibonacci) hash of the key, a table with 2^bits slots takes the highest
+            // bits. Cheap, and consecutive keys fall into distinct slots.
+            template <typename TKey>
+            uint64_t hash(TKey const &key)
+            {
+                return static_cast<uint64_t>(std::hash<TKey>{}(key)) * 0x9e3779b97f4a7c15ULL;
+            }
+
+            // Partition of the radix-partitioned path. The bits of the key are mixed differently than
+            // by hash (the finalizer of MurmurHash3), so that the keys of one partition still spread
+            // over all slots of its table.
+            template <typename TKey>
+            size_t partition_of(TKey const &key, size_t radix_bits)
+            {
+                if (radix_bits == 0)
+                {
+                    return 0;
+                }
+                auto h = static_cast<uint64_t>(std::hash<TKey>{}(key));
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccdULL;
+                h ^= h >> 33;
+                h *= 0xc4ceb9fe1a85ec53ULL;
+                h ^= h >> 33;
+                return static_cast<size_t>(h >> (64 - radix_bits));
+            }
+
+            // Inputs with fewer pairs are reduced by the calling thread alone
+            constexpr size_t min_parallel_size = size_t{1} << 14;
+
+            // Keys that parallel::reduce draws to estimate the number of groups
+            constexpr size_t cardinality_sample = size_t{1} << 14;
+
+            // Partitions of the radix-partitioned path, chosen such that the table of a partition
+            // fits into the L2 cache for up to a few million groups
+            constexpr size_t default_radix_bits = 8;
+        }
+
+        // Open-addressing hash table from key to top two with linear probing. Key, result and the
+        // occupied flag of a slot are stored together, so that a lookup usually touches a single
+        // cache line. The table grows when it is half full.
+        template <typename TKey, typename T = int32_t, typename Compare = Less<T>>
+        class TGroupTable
+        {
+        public:
+            using TRes = TBasicResult<T, Compare>;
+
+            explicit TGroupTable(size_t expected_groups = 0)
+                : entries(std::bit_ceil(std::max<size_t>(16, 2 * expected_groups))) {}
+
+            void push(TKey const &key, T value)
+            {
+                auto &result = find_or_insert(key, detail::hash(key));
+                result = top_two::parallel::ReduceOp<T, Compare>{}(result, value);
+            }
+
+            // Merges the partial top two of another table, e.g. of another thread
+            void merge(TGroupTable const &other)
+            {
+                for (auto const &entry : other.entries)
+                {
+                    if (entry.used)
+                    {
+                        auto &result = find_or_insert(entry.key, detail::hash(entry.key));
+                        result = top_two::parallel::ReduceOp<T, Compare>{}(result, entry.result);
+                    }
+                }
+            }
+
+            size_t size() const { return n_groups; }
+
+            void append_to(TGroups<TKey, T, Compare> &groups) const
+            {
+                for (auto const &entry : entries)
+                {
+                    if (entry.used)
+                    {
+                        groups.keys.push_back(entry.key);
+                        groups.results.push_back(top_two::detail::finish(entry.result));
+                    }
+                }
+            }
+
+            TGroups<TKey, T, Compare> groups() const
+            {
+                TGroups<TKey, T, Compare> result;
+                result.keys.reserve(n_groups);
+                result.results.reserve(n_groups);
+                append_to(result);
+                return result;
+            }
+
+        private:
+            struct TEntry
+            {
+                TKey key{};
+                TRes result;
+                bool used = false;
+            };
+
+            TRes &find_or_insert(TKey const &key, uint64_t hash)
+            {
+                auto const mask = entries.size() - 1;
+                auto slot = static_cast<size_t>(hash >> shift);
+                while (entries[slot].used)
+                {
+                    if (entries[slot].key == key)
+                    {
+                        return entries[slot].result;
+                    }
+                    slot = (slot + 1) & mask;
+                }
+                if (2 * (n_groups + 1) > entries.size())
+                {
+                    grow();
+                    return find_or_insert(key, hash);
+                }
+                entries[slot].key = key;
+                entries[slot].used = true;
+                ++n_groups;
+                return entries[slot].result;
+            }
+
+            void grow()
+            {
+                std::vector<TEntry> old(2 * entries.size());
+                old.swap(entries);
+                --shift;
+                auto const mask = entries.size() - 1;
+                for (auto const &entry : old)
+                {
+                    if (entry.used)
+                    {
+                        auto slot = static_cast<size_t>(detail::hash(entry.key) >> shift);
+                        while (entries[slot].used)
+                        {
+                            slot = (slot + 1) & mask;
+                        }
+                        entries[slot] = entry;
+                    }
+                }
+            }
+
+            std::vector<TEntry> entries;
+            size_t n_groups = 0;
+            int shift = 64 - std::countr_zero(entries.size()); // a slot is the highest bits of the hash
+        };
+
+        namespace detail
+        {
+            template <typename TKey, typename T>
+            void check_columns(std::span<TKey const> keys, std::span<T const> values)
+            {
+                if (keys.size() != values.size())
+                {
+                    throw std::invalid_argument("grouped: " + std::to_string(keys.size()) + " keys but " + std::to_string(values.size()) + " values");
+                }
+            }
+
+            // Distinct keys among evenly spaced keys of the input, at most the size of the sample
+            template <typename TKey>
+            size_t estimate_groups(std::span<TKey const> keys)
+            {
+                auto const n_sample = std::min(keys.size(), cardinality_sample);
+                TGroupTable<TKey, int32_t> sample(n_sample);
+                for (size_t i = 0; i < n_sample; ++i)
+                {
+                    sample.push(keys[i * keys.size() / n_sample], 0);
+                }
+                return sample.size();
+            }
+        }
+
+        namespace sequential
+        {
+            template <typename TKey, typename T = int32_t, typename Compare = Less<T>>
+            TGroups<TKey, T, Compare> accumulate(std::span<TKey const> keys, std::span<T const> values)
+            {
+                detail::check_columns(keys, values);
+                TGroupTable<TKey, T, Compare> table;
+                for (size_t i = 0; i < keys.size(); ++i)
+                {
+                    table.push(keys[i], values[i]);
+                }
+                return table.groups();
+            }
+        }
+
+        namespace parallel
+        {
+            // Every worker of the pool reduces one contiguous range of the input into a table of its
+            // own, and the tables are merged afterwards. Merging costs O(groups * threads), so this
+            // suits inputs with few groups, whose tables stay in the caches of the workers.
+            template <typename TKey, typename T = int32_t, typename Compare = Less<T>>
+            TGroups<TKey, T, Compare> reduce_local(std::span<TKey const> keys, std::span<T const> values, TThreadPool &pool = default_pool())
+            {
+                detail::check_columns(keys, values);
+                if (keys.size() < detail::min_parallel_size || pool.size() == 1)
+                {
+                    return sequential::accumulate<TKey, T, Compare>(keys, values);
+                }
+
+                auto const grain = (keys.size() + pool.size() - 1) / pool.size();
+                std::vector<TGroupTable<TKey, T, Compare>> tables(pool.size());
+                pool.for_each_block(keys.size(), [&](size_t first, size_t last)
+                                    {
+                                        auto &table = tables[first / grain];
+                                        for (auto i = first; i < last; ++i)
+                                        {
+                                            table.push(keys[i], values[i]);
+                                        }
+                                    },
+                                    grain);
+
+                for (size_t t = 1; t < tables.size(); ++t)
+                {
+                    tables[0].merge(tables[t]);
+                }
+                return tables[0].groups();
+            }
+
+            // Radix-partitioned aggregation for many groups, where one table per thread would not fit
+            // into the caches and merging the tables would cost as much as building them:
+            //   1. every worker counts the pairs of its range per partition, i.e. per value of
+            //      radix_bits bits of the mixed key, see detail::partition_of
+            //   2. every worker scatters its pairs into the partitions, at offsets that follow from the
+            //      prefix sums of the counts, so the partitioned columns are written without locks
+            //   3. the partitions are reduced independently, each into a small table
+            // Every key belongs to exactly one partition, so the tables need no merge.
+            template <typename TKey, typename T = int32_t, typename Compare = Less<T>>
+            TGroups<TKey, T, Compare> reduce_partitioned(std::span<TKey const> keys, std::span<T const> values, TThreadPool &pool = default_pool(),
+                                                         size_t radix_bits = detail::default_radix_bits)
+            {
+                detail::check_columns(keys, values);
+                auto const n = keys.size();
+                auto const n_partitions = size_t{1} << radix_bits;
+
+                auto const n_ranges = pool.size();
+                auto const grain = std::max<size_t>(1, (n + n_ranges - 1) / n_ranges);
+                // offsets[range * n_partitions + p] is the count and then the write position of the
+                // pairs of a range in partition p
+                std::vector<size_t> offsets(n_ranges * n_partitions, 0);
+                pool.for_each_block(n, [&](size_t first, size_t last)
+                                    {
+                                        auto *counts = offsets.data() + (first / grain) * n_partitions;
+                                        for (auto i = first; i < last; ++i)
+                                        {
+                                            ++counts[detail::partition_of(keys[i], radix_bits)];
+                                        }
+                                    },
+                                    grain);
+
+                // partition p starts at partition_start[p], and within p the ranges follow each other
+                std::vector<size_t> partition_start(n_partitions + 1, 0);
+                size_t position = 0;
+                for (size_t p = 0; p < n_partitions; ++p)
+                {
+                    partition_start[p] = position;
+                    for (size_t range = 0; range < n_ranges; ++range)
+                    {
+                        auto const count = offsets[range * n_partitions + p];
+                        offsets[range * n_partitions + p] = position;
+                        position += count;
+                    }
+                }
+                partition_start[n_partitions] = position;
+
+                std::vector<TKey> partitioned_keys(n);
+                std::vector<T> partitioned_values(n);
+                pool.for_each_block(n, [&](size_t first, size_t last)
+                                    {
+                                        auto *positions = offsets.data() + (first / grain) * n_partitions;
+                                        for (auto i = first; i < last; ++i)
+                                        {
+                                            auto const target = positions[detail::partition_of(keys[i], radix_bits)]++;
+                                            partitioned_keys[target] = keys[i];
+                                            partitioned_values[target] = values[i];
+                                        }
+                                    },
+                                    grain);
+
+                std::vector<TGroups<TKey, T, Compare>> partitions(n_partitions);
+                pool.for_each_block(n_partitions, [&](size_t first, size_t last)
+                                    {
+                                        for (auto p = first; p < last; ++p)
+                                        {
+                                            TGroupTable<TKey, T, Compare> table;
+                                            for (auto i = partition_start[p]; i < partition_start[p + 1]; ++i)
+                                            {
+                                                table.push(partitioned_keys[i], partitioned_values[i]);
+                                            }
+                                            partitions[p] = table.groups();
+                                        }
+                                    },
+                                    1);
+
+                TGroups<TKey, T, Compare> result;
+                for (auto &partition : partitions)
+                {
+                    result.keys.insert(result.keys.end(), partition.keys.cbegin(), partition.keys.cend());
+                    result.results.insert(result.results.end(), partition.results.cbegin(), partition.results.cend());
+                }
+                return result;
+            }
+
+            // Thread-local tables for few groups and the radix-partitioned path for many groups. The
+            // number of groups is estimated from a sample of the keys: thread-local tables are used if
+            // the sample contains each group about twice on average or more.
+            template <typename TKey, typename T = int32_t, typename Compare = Less<T>>
+            TGroups<TKey, T, Compare> reduce(std::span<TKey const> keys, std::span<T const> values, TThreadPool &pool = default_pool())
+            {
+                detail::check_columns(keys, values);
+                if (keys.size() < detail::min_parallel_size || pool.size() == 1)
+                {
+                    return sequential::accumulate<TKey, T, Compare>(keys, values);
+                }
+                if (2 * detail::estimate_groups(keys) <= std::min(keys.size(), detail::cardinality_sample))
+                {
+                    return reduce_local<TKey, T, Compare>(keys, values, pool);
+                }
+                return reduce_partitioned<TKey, T, Compare>(keys, values, pool);
+            }
+        }
+    }
+}
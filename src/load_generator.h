@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace top_two
+{
+    namespace benchmark
+    {
+        // Latency histogram with logarithmic buckets that are split into linear sub-buckets, like
+        // HdrHistogram. Values below 2^NBits are counted exactly; larger values have a relative
+        // error below 2^-(NBits - 1), e.g. 1.6% for NBits = 7. Recording is O(1) and the memory is
+        // constant, so every request of a long run can be recorded.
+        template <size_t NBits = 7>
+        class THistogram
+        {
+        public:
+            THistogram() : counts(n_counts(), 0) {}
+
+            void record(uint64_t value)
+            {
+                ++counts[index_of(value)];
+                ++n_values;
+                sum += static_cast<double>(value);
+                min_value = std::min(min_value, value);
+                max_value = std::max(max_value, value);
+            }
+
+            void merge(THistogram const &other)
+            {
+                for (size_t i = 0; i < counts.size(); ++i)
+                {
+                    counts[i] += other.counts[i];
+                }
+                n_values += other.n_values;
+                sum += other.sum;
+                min_value = std::min(min_value, other.min_value);
+                max_value = std::max(max_value, other.max_value);
+            }
+
+            uint64_t count() const { return n_values; }
+            uint64_t min() const { return n_values == 0 ? 0 : min_value; }
+            uint64_t max() const { return max_value; }
+            double mean() const { return n_values == 0 ? NAN : sum / static_cast<double>(n_values); }
+
+            // Smallest value such that at least percentile % of the values are not larger, reported
+            // as the upper end of its bucket, i.e. never below the exact percentile
+            uint64_t value_at_percentile(double percentile) const
+            {
+                if (n_values == 0)
+                {
+                    return 0;
+                }
+                auto const rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(n_values))));
+                uint64_t seen = 0;
+                for (size_t i = 0; i < counts.size(); ++i)
+                {
+                    seen += counts[i];
+                    if (seen >= rank)
+                    {
+                        return std::min(upper_bound_of(i), max_value);
+                    }
+                }
+                return max_value;
+            }
+
+        private:
+            static constexpr uint64_t n_sub_buckets = uint64_t{1} << NBits;
+
+            static size_t n_counts()
+            {
+                return n_sub_buckets + (64 - NBits) * (n_sub_buckets / 2);
+            }
+
+            // Bucket k > 0 holds [2^(NBits + k - 1), 2^(NBits + k)) in n_sub_buckets / 2 steps of 2^k
+            static size_t index_of(uint64_t value)
+            {
+                if (value < n_sub_buckets)
+                {
+                    return static_cast<size_t>(value);
+                }
+                auto const bucket = static_cast<size_t>(std::bit_width(value)) - NBits;
+                return n_sub_buckets + (bucket - 1) * (n_sub_buckets / 2) + static_cast<size_t>((value >> bucket) - n_sub_buckets / 2);
+            }
+
+            static uint64_t upper_bound_of(size_t index)
+            {
+                if (index < n_sub_buckets)
+                {
+                    return index;
+                }
+                auto const bucket = (index - n_sub_buckets) / (n_sub_buckets / 2) + 1;
+                auto const sub_bucket = (index - n_sub_buckets) % (n_sub_buckets / 2) + n_sub_buckets / 2;
+                return ((sub_bucket + 1) << bucket) - 1;
+            }
+
+            std::vector<uint64_t> counts;
+            uint64_t n_values = 0;
+            double sum = 0.0;
+            uint64_t min_value = UINT64_MAX;
+            uint64_t max_value = 0;
+        };
+
+        struct TLoadConfig
+        {
+            size_t n_clients = 1;
+            double target_qps = 0.0; // requests per second of all clients together, 0 sends the next request as soon as the previous one returned
+            std::chrono::milliseconds duration{2'000};
+        };
+
+        struct TLoadResult
+        {
+            THistogram<> latencies; // ns, from the scheduled start to the end of a request
+            size_t n_requests = 0;
+            double duration_s = 0.0;
+
+            double throughput() const { return n_requests / duration_s; }
+        };
+
+        // Runs n_clients threads that call query(client) concurrently for the duration. With a
+        // target rate, every client sends its requests on a fixed schedule and the latency of a
+        // request is measured from its scheduled start, so that a slow request also counts against
+        // the requests that queued up behind it (no coordinated omission).
+        template <typename Query>
+        TLoadResult run_load(TLoadConfig const &config, Query query)
+        {
+            using TClock = std::chrono::steady_clock;
+            auto const n_clients = std::max<size_t>(1, config.n_clients);
+            std::vector<THistogram<>> histograms(n_clients);
+
+            auto const start = TClock::now() + std::chrono::milliseconds(10); // all clients are running by then
+            auto const end = start + config.duration;
+            auto const interval = config.target_qps > 0.0
+                                      ? std::chrono::duration_cast<TClock::duration>(std::chrono::duration<double>(n_clients / config.target_qps))
+                                      : TClock::duration::zero();
+
+            std::vector<std::thread> clients;
+            for (size_t client = 0; client < n_clients; ++client)
+            {
+                clients.emplace_back([&, client]
+                                     {
+                                         // the schedules of the clients are staggered evenly
+                                         auto scheduled = start + interval * static_cast<int64_t>(client) / static_cast<int64_t>(n_clients);
+                                         std::this_thread::sleep_until(scheduled);
+                                         while (scheduled < end)
+                                         {
+                                             if (interval == TClock::duration::zero())
+                                             {
+                                                 scheduled = TClock::now();
+                                             }
+                                             else
+                                             {
+                                                 std::this_thread::sleep_until(scheduled);
+                                             }
+                                             query(client);
+                                             auto const done = TClock::now();
+                                             histograms[client].record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - scheduled).count()));
+                                             scheduled += interval;
+                                             if (interval == TClock::duration::zero() && done >= end)
+                                             {
+                                                 break;
+                                             }
+                                         }
+                                     });
+            }
+            for (auto &client : clients)
+            {
+                client.join();
+            }
+
+            TLoadResult result;
+            for (auto const &histogram : histograms)
+            {
+                result.latencies.merge(histogram);
+            }
+            result.n_requests = result.latencies.count();
+            result.duration_s = std::chrono::duration<double>(std::max(TClock::now(), end) - start).count();
+            return result;
+        }
+    }
+}
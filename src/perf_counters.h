@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace top_two
+{
+    namespace benchmark
+    {
+        // Hardware events per algorithm call, NaN for events that were not recorded
+        struct TCounterValues
+        {
+            double cycles = NAN;
+            double instructions = NAN;
+            double branch_misses = NAN;
+            double l1d_misses = NAN; // L1 data cache read misses
+            double llc_misses = NAN; // last level cache misses
+
+            TCounterValues operator/(double n) const
+            {
+                return {cycles / n, instructions / n, branch_misses / n, l1d_misses / n, llc_misses / n};
+            }
+        };
+
+        // Counts hardware events of the calling thread and of the threads it creates while the counters
+        // are open, with perf_event_open. Each event is opened on its own, so an event the CPU or the
+        // kernel does not support only leaves its own value at NaN. Inside containers or with a
+        // restrictive kernel.perf_event_paranoid, usually no event can be opened; available() is then
+        // false and all values are NaN.
+        class TPerfCounters
+        {
+        public:
+            TPerfCounters()
+            {
+#ifdef __linux__
+                constexpr uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                std::array<std::pair<uint32_t, uint64_t>, n_events> const events{{
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+                    {PERF_TYPE_HW_CACHE, l1d_read_miss},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                }};
+
+                for (size_t event = 0; event < n_events; ++event)
+                {
+                    perf_event_attr attr{};
+                    attr.size = sizeof(attr);
+                    attr.type = events[event].first;
+                    attr.config = events[event].second;
+                    attr.disabled = 1;
+                    attr.inherit = 1;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    fds[event] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+                }
+#endif
+            }
+
+            ~TPerfCounters()
+            {
+#ifdef __linux__
+                for (auto fd : fds)
+                {
+                    if (fd >= 0)
+                    {
+                        close(fd);
+                    }
+                }
+#endif
+            }
+
+            TPerfCounters(TPerfCounters const &) = delete;
+            TPerfCounters &operator=(TPerfCounters const &) = delete;
+
+            bool available() const
+            {
+                for (auto fd : fds)
+                {
+                    if (fd >= 0)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void reset() { control(Request::reset); }
+            void enable() { control(Request::enable); }
+            void disable() { control(Request::disable); }
+
+            // Totals since the last reset(), scaled up if the kernel had to multiplex the events
+            TCounterValues read() const
+            {
+                std::array<double, n_events> values;
+                for (size_t event = 0; event < n_events; ++event)
+                {
+                    values[event] = read(fds[event]);
+                }
+                return {values[0], values[1], values[2], values[3], values[4]};
+            }
+
+        private:
+            static constexpr size_t n_events = 5;
+
+            enum class Request
+            {
+                reset,
+                enable,
+                disable
+            };
+
+            void control([[maybe_unused]] Request request)
+            {
+#ifdef __linux__
+                auto const ioctl_request = request == Request::reset    ? PERF_EVENT_IOC_RESET
+                                           : request == Request::enable ? PERF_EVENT_IOC_ENABLE
+                                                                        : PERF_EVENT_IOC_DISABLE;
+                for (auto fd : fds)
+                {
+                    if (fd >= 0)
+                    {
+                        ioctl(fd, ioctl_request, 0);
+                    }
+                }
+#endif
+            }
+
+            static double read([[maybe_unused]] int fd)
+            {
+#ifdef __linux__
+                uint64_t data[3]; // value, time enabled, time running
+                if (fd < 0 || ::read(fd, data, sizeof(data)) != sizeof(data))
+                {
+                    return NAN;
+                }
+                if (data[2] == 0)
+                {
+                    return data[1] == 0 ? 0.0 : NAN;
+                }
+                return static_cast<double>(data[0]) * data[1] / data[2];
+#else
+                return NAN;
+#endif
+            }
+
+            std::array<int, n_events> fds{-1, -1, -1, -1, -1};
+        };
+    }
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "algorithms.h"
+
+namespace top_two
+{
+    namespace detail
+    {
+        // Elements per task of the candidate pass, see simd::detail::chunk_size
+        constexpr size_t select_chunk_size = size_t{1} << 16;
+
+        // Elements that are tested for candidates at once before they are collected
+        constexpr size_t select_block_size = 256;
+
+        // Values that are drawn to estimate the pivot. Every drawn value is a cache miss, so the
+        // sample grows with the input.
+        inline size_t sample_size(size_t n)
+        {
+            return std::min(n, std::clamp<size_t>(n / 1'024, 1'024, size_t{1} << 16));
+        }
+
+        template <typename T>
+        struct TCandidates
+        {
+            std::vector<T> larger; // values larger than the pivot
+            size_t n_equal = 0;    // values equivalent to the pivot
+        };
+
+        // Rank from the top of the sample at which the pivot is taken. The expected number of
+        // values that are not less than the pivot exceeds k by three standard deviations.
+        inline size_t pivot_rank(size_t n, size_t k, size_t n_sample)
+        {
+            auto const expected = static_cast<double>(k) * n_sample / n;
+            return std::min(n_sample - 1, static_cast<size_t>(expected + 3.0 * std::sqrt(expected) + 1.0));
+        }
+    }
+
+    namespace top_k
+    {
+        enum class Order
+        {
+            unsorted,
+            sorted // ascending like TTopK, i.e. the largest value is the last one
+        };
+
+        namespace parallel
+        {
+            // The k largest values for k up to the size of the input, e.g. k in the thousands, where
+            // TTopK would be too large. The input is neither copied nor permuted:
+            //   1. a pivot is estimated from a random sample, so that slightly more than k values are
+            //      not less than the pivot
+            //   2. in parallel, every chunk of the input collects the values larger than the pivot in
+            //      a buffer of its own and counts the values equivalent to the pivot
+            //   3. the k largest values are selected among the candidates; copies of the pivot fill
+            //      up the result if there are fewer than k larger values
+            // If the sample underestimates the number of large values, step 2 is repeated with a
+            // lower pivot. The memory besides the result is O(k + sample size) in the expected case.
+            // NanPolicy::propagate is treated like NanPolicy::largest. The chunks of step 2 run on the
+            // Backend, whose policy has to allow allocation in the tasks, i.e. not unsequenced.
+            template <typename T = int32_t, typename Compare = Less<T>, typename Backend = backend::Std<std::execution::parallel_policy>>
+            std::vector<T> select(std::span<T const> values, size_t k, Order order = Order::unsorted)
+            {
+                Compare const less;
+                auto const greater = [less](T lhs, T rhs) { return less(rhs, lhs); };
+                auto const n = values.size();
+                k = std::min(k, n);
+
+                std::vector<T> result;
+                if (k == 0)
+                {
+                    return result;
+                }
+                if (2 * k >= n)
+                {
+                    // the result is about as large as the input
+                    result.assign(values.begin(), values.end());
+                    std::nth_element(result.begin(), result.begin() + (k - 1), result.end(), greater);
+                    result.resize(k);
+                }
+                else
+                {
+                    std::mt19937 rng(19937);
+                    std::uniform_int_distribution<size_t> index_distribution(0, n - 1);
+                    std::vector<T> sample(detail::sample_size(n));
+                    for (auto &value : sample)
+                    {
+                        value = values[index_distribution(rng)];
+                    }
+
+                    auto const n_chunks = (n + detail::select_chunk_size - 1) / detail::select_chunk_size;
+
+                    auto rank = detail::pivot_rank(n, k, sample.size());
+                    while (true)
+                    {
+                        std::nth_element(sample.begin(), sample.begin() + rank, sample.end(), greater);
+                        auto const pivot = sample[rank];
+                        std::vector<detail::TCandidates<T>> candidates(n_chunks);
+                        Backend::for_chunks(n_chunks, [&](size_t chunk)
+                                           {
+                                               // counted locally, the counters of neighbouring chunks share cache lines
+                                               detail::TCandidates<T> own;
+                                               auto const first = chunk * detail::select_chunk_size;
+                                               auto const last = std::min(n, first + detail::select_chunk_size);
+                                               for (auto block = first; block < last; block += detail::select_block_size)
+                                               {
+                                                   auto const block_last = std::min(last, block + detail::select_block_size);
+                                                   // most blocks hold no candidate, this test is vectorized
+                                                   bool any = false;
+                                                   for (auto i = block; i < block_last; ++i)
+                                                   {
+                                                       any |= !less(values[i], pivot);
+                                                   }
+                                                   if (!any)
+                                                   {
+                                                       continue;
+                                                   }
+                                                   for (auto i = block; i < block_last; ++i)
+                                                   {
+                                                       if (less(pivot, values[i]))
+                                                       {
+                                                           own.larger.push_back(values[i]);
+                                                       }
+                                                       else if (!less(values[i], pivot))
+                                                       {
+                                                           ++own.n_equal;
+                                                       }
+                                                   }
+                                               }
+                                               candidates[chunk] = std::move(own);
+                                           });
+
+                        size_t n_larger = 0, n_equal = 0;
+                        for (auto const &own : candidates)
+                        {
+                            n_larger += own.larger.size();
+                            n_equal += own.n_equal;
+                        }
+                        if (n_larger + n_equal < k && rank + 1 < sample.size())
+                        {
+                            // the pivot was too large, retry with one twice as far down the sample
+                            rank = std::min(sample.size() - 1, 2 * rank + 1);
+                            continue;
+                        }
+                        if (n_larger + n_equal < k)
+                        {
+                            // even the smallest sampled value is too large, e.g. for k close to n
+                            result.assign(values.begin(), values.end());
+                            std::nth_element(result.begin(), result.begin() + (k - 1), result.end(), greater);
+                            result.resize(k);
+                            break;
+                        }
+
+                        result.reserve(std::max(n_larger, k));
+                        for (auto const &own : candidates)
+                        {
+                            result.insert(result.end(), own.larger.cbegin(), own.larger.cend());
+                        }
+                        if (n_larger >= k)
+                        {
+                            std::nth_element(result.begin(), result.begin() + (k - 1), result.end(), greater);
+                            result.resize(k);
+                        }
+                        else
+                        {
+                            result.resize(k, pivot);
+                        }
+                        break;
+                    }
+                }
+
+                if (order == Order::sorted)
+                {
+                    std::sort(result.begin(), result.end(), less);
+                }
+                return result;
+            }
+        }
+    }
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "algorithms.h"
+#include "simd.h"
+
+namespace top_two
+{
+    // Top two of data that is split into shards owned by separate processes. Every worker reduces its
+    // shard and publishes the partial result in its slot of a POSIX shared memory segment; a
+    // coordinator merges the published partials with parallel::ReduceOp. Nothing but the partial
+    // results crosses process boundaries.
+    //
+    // Publication is lock-free. A slot has two buffers and a version; publication v is written to
+    // buffers[v % 2] and becomes visible with one release store of the version, so a reader never
+    // waits for a writer, and a worker that dies while writing leaves the previous publication
+    // intact. Every buffer is a seqlock, so a reader that is overtaken by two publications retries,
+    // a bounded number of times. A restarted worker publishes into its slot again and replaces its
+    // earlier partial instead of being merged twice, also if the worker died in the middle of a
+    // publication. There is one writer per slot.
+    namespace shard
+    {
+        enum class Role
+        {
+            coordinator, // creates the segment and removes its name at the end
+            worker       // opens the segment of a coordinator
+        };
+
+        namespace detail
+        {
+            constexpr uint64_t magic = 0x544f50325348524e; // "TOP2SHRN"
+
+            // Reads of a slot that is overtaken by publications this often count as not published
+            constexpr size_t max_read_attempts = 64;
+
+            template <typename T>
+            struct TBuffer
+            {
+                std::atomic<uint64_t> sequence; // odd while the buffer is written
+                std::atomic<T> second_largest;
+                std::atomic<T> largest;
+            };
+
+            template <typename T>
+            struct alignas(64) TSlot
+            {
+                std::atomic<uint64_t> version; // number of publications, 0 if the shard has not published
+                TBuffer<T> buffers[2];
+            };
+
+            struct THeader
+            {
+                uint64_t magic;
+                uint64_t n_shards;
+                uint64_t value_size;
+            };
+
+            template <typename T>
+            constexpr size_t segment_size(size_t n_shards)
+            {
+                return sizeof(TSlot<T>) + n_shards * sizeof(TSlot<T>); // the header takes the place of one slot
+            }
+        }
+
+        template <typename T = int32_t>
+        class TSegment
+        {
+            static_assert(std::atomic<T>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+                          "atomics in shared memory have to be lock-free");
+            static_assert(sizeof(detail::THeader) <= sizeof(detail::TSlot<T>));
+
+        public:
+            using TRes = TBasicResult<T>;
+
+            // name is a shared memory name like "/top_two", n_shards is only used by the coordinator.
+            // Throws std::system_error if the segment cannot be created or opened, and
+            // std::runtime_error if a worker opens a segment of another value type.
+            TSegment(std::string const &name_, Role role_, size_t n_shards_ = 0) : name(name_), role(role_)
+            {
+                auto const fd = ::shm_open(name.c_str(), role == Role::coordinator ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0600);
+                if (fd < 0)
+                {
+                    throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+                }
+
+                if (role == Role::coordinator)
+                {
+                    n_shards = n_shards_;
+                    size = detail::segment_size<T>(n_shards);
+                    if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+                    {
+                        auto const error = errno;
+                        ::close(fd);
+                        ::shm_unlink(name.c_str());
+                        throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+                    }
+                }
+                else
+                {
+                    struct stat status;
+                    if (::fstat(fd, &status) != 0)
+                    {
+                        auto const error = errno;
+                        ::close(fd);
+                        throw std::system_error(error, std::generic_category(), "fstat " + name);
+                    }
+                    size = static_cast<size_t>(status.st_size);
+                }
+
+                address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                auto const error = errno;
+                ::close(fd);
+                if (address == MAP_FAILED)
+                {
+                    if (role == Role::coordinator)
+                    {
+                        ::shm_unlink(name.c_str());
+                    }
+                    throw std::system_error(error, std::generic_category(), "mmap " + name);
+                }
+
+                auto &header = *static_cast<detail::THeader *>(address);
+                if (role == Role::coordinator)
+                {
+                    // the truncated segment is zero, i.e. no slot has been published
+                    header = {detail::magic, n_shards, sizeof(T)};
+                }
+                else if (size < sizeof(detail::THeader) || header.magic != detail::magic || header.value_size != sizeof(T) ||
+                         size < detail::segment_size<T>(header.n_shards))
+                {
+                    ::munmap(address, size);
+                    throw std::runtime_error("not a shard segment of this value type: " + name);
+                }
+                n_shards = header.n_shards;
+            }
+
+            ~TSegment()
+            {
+                ::munmap(address, size);
+                if (role == Role::coordinator)
+                {
+                    ::shm_unlink(name.c_str());
+                }
+            }
+
+            TSegment(TSegment const &) = delete;
+            TSegment &operator=(TSegment const &) = delete;
+
+            size_t size_in_shards() const { return n_shards; }
+
+            void publish(size_t shard, TRes const &result)
+            {
+                auto &current = slot(shard);
+                auto const version = current.version.load(std::memory_order_relaxed) + 1;
+                auto &buffer = current.buffers[version % 2];
+
+                // the sequence is still odd if the previous writer of the slot died while writing
+                // this buffer, and has to become even again at the end
+                auto const begin = buffer.sequence.load(std::memory_order_relaxed) | 1;
+                buffer.sequence.store(begin, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                buffer.second_largest.store(result.second_largest, std::memory_order_relaxed);
+                buffer.largest.store(result.largest, std::memory_order_relaxed);
+                buffer.sequence.store(begin + 1, std::memory_order_release);
+
+                current.version.store(version, std::memory_order_release);
+            }
+
+            // Latest partial result of a shard, empty if it has not published yet or if no consistent
+            // publication could be read within detail::max_read_attempts attempts
+            std::optional<TRes> read(size_t shard) const
+            {
+                auto const &current = slot(shard);
+                for (size_t attempt = 0; attempt < detail::max_read_attempts; ++attempt)
+                {
+                    auto const version = current.version.load(std::memory_order_acquire);
+                    if (version == 0)
+                    {
+                        return std::nullopt;
+                    }
+
+                    auto const &buffer = current.buffers[version % 2];
+                    auto const sequence = buffer.sequence.load(std::memory_order_acquire);
+                    TRes const result{buffer.second_largest.load(std::memory_order_relaxed), buffer.largest.load(std::memory_order_relaxed)};
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (sequence % 2 == 0 && buffer.sequence.load(std::memory_order_relaxed) == sequence)
+                    {
+                        return result;
+                    }
+                    // overtaken by two publications, read the newest one
+                }
+                return std::nullopt;
+            }
+
+            // Number of publications of a shard, e.g. to notice a restarted worker
+            uint64_t version(size_t shard) const
+            {
+                return slot(shard).version.load(std::memory_order_acquire);
+            }
+
+        private:
+            detail::TSlot<T> &slot(size_t shard) const
+            {
+                if (shard >= n_shards)
+                {
+                    throw std::out_of_range("shard " + std::to_string(shard) + " of " + std::to_string(n_shards));
+                }
+                return static_cast<detail::TSlot<T> *>(address)[shard + 1];
+            }
+
+            std::string name;
+            Role role;
+            size_t n_shards = 0;
+            size_t size = 0;
+            void *address = nullptr;
+        };
+
+        // Reduces the shard of a worker with the simd kernel and publishes the result
+        template <typename T = int32_t>
+        void publish(TSegment<T> &segment, size_t shard, std::span<T const> values)
+        {
+            segment.publish(shard, simd::detail::kernel<T>(simd::best_isa())(values.data(), values.data() + values.size()));
+        }
+
+        template <typename T = int32_t>
+        struct TMerged
+        {
+            TBasicResult<T> result;
+            size_t n_published = 0; // shards merged into result
+        };
+
+        // Merges the partial results that are published at the moment
+        template <typename T = int32_t>
+        TMerged<T> merge(TSegment<T> const &segment)
+        {
+            TMerged<T> merged;
+            for (size_t shard = 0; shard < segment.size_in_shards(); ++shard)
+            {
+                if (auto const partial = segment.read(shard))
+                {
+                    merged.result = parallel::ReduceOp<T>{}(merged.result, *partial);
+                    ++merged.n_published;
+                }
+            }
+            merged.result = top_two::detail::finish(merged.result);
+            return merged;
+        }
+
+        // Merges once every shard has published or the timeout has expired, whichever comes first.
+        // Shards that are late are missing from the result, see n_published; a later merge picks
+        // them up.
+        template <typename T = int32_t>
+        TMerged<T> wait_and_merge(TSegment<T> const &segment, std::chrono::milliseconds timeout)
+        {
+            auto const deadline = std::chrono::steady_clock::now() + timeout;
+            auto merged = merge(segment);
+            while (merged.n_published < segment.size_in_shards() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                merged = merge(segment);
+            }
+            return merged;
+        }
+    }
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TOP_TWO_SIMD_X86 1
+#endif
+
+#include "algorithms.h"
+
+namespace top_two
+{
+    namespace simd
+    {
+        // Instruction sets for which an explicit kernel exists, in order of increasing vector width.
+        // avx512 requires AVX-512BW in addition to AVX-512F for the 8-bit and 16-bit lanes.
+        enum class Isa
+        {
+            scalar,
+            sse41,
+            avx2,
+            avx512
+        };
+
+        inline char const *to_string(Isa isa)
+        {
+            switch (isa)
+            {
+            case Isa::sse41:
+                return "sse4.1";
+            case Isa::avx2:
+                return "avx2";
+            case Isa::avx512:
+                return "avx512";
+            default:
+                return "scalar";
+            }
+        }
+
+        inline bool is_supported(Isa isa)
+        {
+#ifdef TOP_TWO_SIMD_X86
+            switch (isa)
+            {
+            case Isa::sse41:
+                return __builtin_cpu_supports("sse4.1");
+            case Isa::avx2:
+                return __builtin_cpu_supports("avx2");
+            case Isa::avx512:
+                return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+            default:
+                return true;
+            }
+#else
+            return isa == Isa::scalar;
+#endif
+        }
+
+        // Widest instruction set supported by the host. Determined once with cpuid.
+        inline Isa best_isa()
+        {
+            static Isa const isa = []
+            {
+                for (auto candidate : {Isa::avx512, Isa::avx2, Isa::sse41})
+                {
+                    if (is_supported(candidate))
+                    {
+                        return candidate;
+                    }
+                }
+                return Isa::scalar;
+            }();
+            return isa;
+        }
+
+        namespace detail
+        {
+            template <typename T>
+            using TKernel = TBasicResult<T> (*)(T const *first, T const *last);
+
+            template <typename T>
+            TBasicResult<T> accumulate_scalar(T const *first, T const *last, TBasicResult<T> init)
+            {
+                return std::accumulate(first, last, init,
+                                       [](TBasicResult<T> const &result, T value) -> TBasicResult<T>
+                                       { return parallel::ReduceOp<T>{}(result, value); });
+            }
+
+            template <typename T>
+            TBasicResult<T> accumulate_scalar(T const *first, T const *last)
+            {
+                return accumulate_scalar(first, last, TBasicResult<T>{});
+            }
+
+            // Horizontal merge of the per-lane results at the end of a vector kernel.
+            template <typename T, size_t NLanes>
+            TBasicResult<T> merge_lanes(std::array<T, NLanes> const &second_largest, std::array<T, NLanes> const &largest)
+            {
+                TBasicResult<T> result;
+                for (size_t lane = 0; lane < NLanes; ++lane)
+                {
+                    result = parallel::ReduceOp<T>{}(result, TBasicResult<T>{second_largest[lane], largest[lane]});
+                }
+                return result;
+            }
+
+            // The kernel keeps one vector of largest and one vector of second largest values per
+            // accumulator. A new vector v is merged lane-wise without branches:
+            //   second_largest = max(second_largest, min(largest, v))
+            //   largest        = max(largest, v)
+            // Two independent accumulators hide the latency of the dependent min/max chain.
+            //
+            // The body is written with generic vectors of NBytes bytes. It is always inlined into the
+            // ISA specific kernels below, so the compiler emits the packed min/max instructions of that
+            // ISA for the element type. A vector holds 4x more 8-bit than 32-bit lanes.
+            template <typename T, size_t NBytes>
+            __attribute__((always_inline)) inline TBasicResult<T> accumulate_vector(T const *first, T const *last)
+            {
+                typedef T TVector __attribute__((vector_size(NBytes)));
+                constexpr size_t n_lanes = NBytes / sizeof(T);
+
+                auto const size = static_cast<size_t>(last - first);
+                auto const lowest = TVector{} + Less<T>::lowest();
+
+                TVector largest_0 = lowest, largest_1 = lowest;
+                TVector second_largest_0 = lowest, second_largest_1 = lowest;
+
+                size_t i = 0;
+                for (; i + 2 * n_lanes <= size; i += 2 * n_lanes)
+                {
+                    TVector v_0, v_1;
+                    std::memcpy(&v_0, first + i, NBytes);
+                    std::memcpy(&v_1, first + i + n_lanes, NBytes);
+
+                    auto const low_0 = v_0 < largest_0 ? v_0 : largest_0;
+                    auto const low_1 = v_1 < largest_1 ? v_1 : largest_1;
+                    second_largest_0 = second_largest_0 < low_0 ? low_0 : second_largest_0;
+                    second_largest_1 = second_largest_1 < low_1 ? low_1 : second_largest_1;
+                    largest_0 = largest_0 < v_0 ? v_0 : largest_0;
+                    largest_1 = largest_1 < v_1 ? v_1 : largest_1;
+                }
+
+                auto const low = largest_0 < largest_1 ? largest_0 : largest_1;
+                second_largest_0 = second_largest_0 < second_largest_1 ? second_largest_1 : second_largest_0;
+                second_largest_0 = second_largest_0 < low ? low : second_largest_0;
+                largest_0 = largest_0 < largest_1 ? largest_1 : largest_0;
+
+                std::array<T, n_lanes> largest, second_largest;
+                std::memcpy(largest.data(), &largest_0, NBytes);
+                std::memcpy(second_largest.data(), &second_largest_0, NBytes);
+
+                return accumulate_scalar(first + i, last, merge_lanes(second_largest, largest));
+            }
+
+#ifdef TOP_TWO_SIMD_X86
+            template <typename T>
+            __attribute__((target("sse4.1")))
+            TBasicResult<T> accumulate_sse41(T const *first, T const *last)
+            {
+                return accumulate_vector<T, 16>(first, last);
+            }
+
+            template <typename T>
+            __attribute__((target("avx2")))
+            TBasicResult<T> accumulate_avx2(T const *first, T const *last)
+            {
+                return accumulate_vector<T, 32>(first, last);
+            }
+
+            template <typename T>
+            __attribute__((target("avx512f,avx512bw")))
+            TBasicResult<T> accumulate_avx512(T const *first, T const *last)
+            {
+                return accumulate_vector<T, 64>(first, last);
+            }
+#endif
+
+            // Vector kernels exist for integral types only. Floating-point values need the NaN policy
+            // of the comparator and are reduced by the scalar kernel. An instruction set the host lacks
+            // is rejected rather than faulting with SIGILL in the kernel.
+            template <typename T>
+            TKernel<T> kernel(Isa isa)
+            {
+                if (!is_supported(isa))
+                {
+                    throw std::invalid_argument(std::string("simd: ") + to_string(isa) + " is not supported by this host");
+                }
+                if constexpr (std::is_integral_v<T>)
+                {
+                    switch (isa)
+                    {
+#ifdef TOP_TWO_SIMD_X86
+                    case Isa::sse41:
+                        return accumulate_sse41<T>;
+                    case Isa::avx2:
+                        return accumulate_avx2<T>;
+                    case Isa::avx512:
+                        return accumulate_avx512<T>;
+#endif
+                    default:
+                        break;
+                    }
+                }
+                return accumulate_scalar<T>;
+            }
+
+            // Elements per task of the parallel reduction. Large enough to amortize the scheduling
+            // overhead, small enough to balance the load across threads.
+            constexpr size_t chunk_size = 1 << 16;
+        }
+
+        // One pass over the data with the widest kernel supported by the host, or with the kernel
+        // for isa. Throws std::invalid_argument if the host does not support isa, see is_supported.
+        template <typename T>
+        TBasicResult<T> accumulate(std::span<T const> values, Isa isa)
+        {
+            return detail::kernel<T>(isa)(values.data(), values.data() + values.size());
+        }
+
+        template <typename T>
+        TBasicResult<T> accumulate(std::span<T const> values)
+        {
+            return accumulate<T>(values, best_isa());
+        }
+
+        // The std::vector overloads deduce T from the argument
+        template <typename T>
+        TBasicResult<T> accumulate(std::vector<T> const &values, Isa isa)
+        {
+            return accumulate<T>(std::span<T const>(values), isa);
+        }
+
+        template <typename T>
+        TBasicResult<T> accumulate(std::vector<T> const &values)
+        {
+            return accumulate<T>(std::span<T const>(values));
+        }
+
+        // Splits the data into chunks that are reduced by the vector kernel in parallel on the
+        // Backend, see parallel::reduce. The partial results are merged with parallel::ReduceOp.
+        // Throws std::invalid_argument for an isa that the host does not support.
+        template <typename T, typename Backend = backend::Std<>>
+        TBasicResult<T> reduce(std::span<T const> values, Isa isa)
+        {
+            auto const kernel = detail::kernel<T>(isa);
+            auto const n_chunks = (values.size() + detail::chunk_size - 1) / detail::chunk_size;
+
+            auto const reduce_chunk = [values, kernel](size_t chunk) -> TBasicResult<T>
+            {
+                auto const first = values.data() + chunk * detail::chunk_size;
+                auto const last = values.data() + std::min(values.size(), (chunk + 1) * detail::chunk_size);
+                return kernel(first, last);
+            };
+
+            return Backend::reduce_chunks(n_chunks, TBasicResult<T>{}, parallel::ReduceOp<T>{}, reduce_chunk);
+        }
+
+        template <typename T, typename Backend = backend::Std<>>
+        TBasicResult<T> reduce(std::span<T const> values)
+        {
+            return reduce<T, Backend>(values, best_isa());
+        }
+
+        template <typename T, typename Backend = backend::Std<>>
+        TBasicResult<T> reduce(std::vector<T> const &values, Isa isa)
+        {
+            return reduce<T, Backend>(std::span<T const>(values), isa);
+        }
+
+        template <typename T, typename Backend = backend::Std<>>
+        TBasicResult<T> reduce(std::vector<T> const &values)
+        {
+            return reduce<T, Backend>(std::span<T const>(values));
+        }
+    }
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "algorithms.h"
+#include "simd.h"
+
+namespace top_two
+{
+    namespace detail
+    {
+        // Stamp of the samples of a window that is bounded by count only
+        struct TNoStamp
+        {
+        };
+
+        // Top two of a chunk, with the simd kernel if one exists for the element type and comparator
+        template <typename T, typename Compare>
+        TBasicResult<T, Compare> reduce_chunk(std::span<T const> values)
+        {
+            if constexpr (std::is_same_v<Compare, Less<T>>)
+            {
+                return simd::detail::kernel<T>(simd::best_isa())(values.data(), values.data() + values.size());
+            }
+            else
+            {
+                return std::accumulate(values.begin(), values.end(), TBasicResult<T, Compare>{}, parallel::ReduceOp<T, Compare>{});
+            }
+        }
+
+        // FIFO queue of samples that knows the top two of its contents, built from two stacks:
+        //   back   the newest samples in arrival order and the top two of all of them
+        //   front  the oldest samples, newest first, every sample with the top two of itself and of
+        //          all newer samples in front
+        // push appends to back and pop removes the last sample of front. If front is empty, pop
+        // first moves all of back to front and computes the top two of the suffixes on the way.
+        // Every sample is moved once, so push and pop are O(1) amortized, and top_two merges the
+        // two stack tops in O(1). The top two cannot be updated by removing a value, which is why a
+        // window needs this instead of a running result.
+        template <typename T, typename Compare, typename TStamp>
+        class TWindowQueue
+        {
+        public:
+            using TRes = TBasicResult<T, Compare>;
+
+            void push(T value, TStamp stamp = {})
+            {
+                back.push_back({value, stamp});
+                back_top_two = parallel::ReduceOp<T, Compare>{}(back_top_two, value);
+            }
+
+            // Appends a chunk to back with one pass of the chunk kernel
+            void push(std::span<T const> values, std::span<TStamp const> stamps = {})
+            {
+                back.reserve(back.size() + values.size());
+                for (size_t i = 0; i < values.size(); ++i)
+                {
+                    back.push_back({values[i], stamps.empty() ? TStamp{} : stamps[i]});
+                }
+                back_top_two = parallel::ReduceOp<T, Compare>{}(back_top_two, reduce_chunk<T, Compare>(values));
+            }
+
+            // Oldest sample, the queue must not be empty
+            TStamp const &oldest_stamp()
+            {
+                refill();
+                return front.back().stamp;
+            }
+
+            void pop()
+            {
+                refill();
+                front.pop_back();
+            }
+
+            // Removes the n oldest samples, or all if there are fewer
+            void pop(size_t n)
+            {
+                while (n > 0 && !empty())
+                {
+                    refill();
+                    auto const k = std::min(n, front.size());
+                    front.resize(front.size() - k);
+                    n -= k;
+                }
+            }
+
+            TRes top_two() const
+            {
+                if (front.empty())
+                {
+                    return back_top_two;
+                }
+                return parallel::ReduceOp<T, Compare>{}(front.back().top_two, back_top_two);
+            }
+
+            size_t size() const { return front.size() + back.size(); }
+            bool empty() const { return front.empty() && back.empty(); }
+
+            void clear()
+            {
+                front.clear();
+                back.clear();
+                back_top_two = TRes{};
+            }
+
+        private:
+            struct TSample
+            {
+                T value;
+                [[no_unique_address]] TStamp stamp;
+            };
+
+            struct TFrontSample
+            {
+                T value;
+                [[no_unique_address]] TStamp stamp;
+                TRes top_two; // of this sample and all newer samples in front
+            };
+
+            void refill()
+            {
+                if (!front.empty())
+                {
+                    return;
+                }
+                front.reserve(back.size());
+                TRes suffix;
+                for (auto it = back.rbegin(); it != back.rend(); ++it)
+                {
+                    suffix = parallel::ReduceOp<T, Compare>{}(suffix, it->value);
+                    front.push_back({it->value, it->stamp, suffix});
+                }
+                back.clear();
+                back_top_two = TRes{};
+            }
+
+            std::vector<TFrontSample> front;
+            std::vector<TSample> back;
+            TRes back_top_two;
+        };
+    }
+
+    // Top two of the last capacity values of a stream. push and top_two are O(1) amortized.
+    template <typename T = int32_t, typename Compare = Less<T>>
+    class TSlidingWindow
+    {
+    public:
+        using TRes = TBasicResult<T, Compare>;
+
+        explicit TSlidingWindow(size_t capacity_) : capacity(std::max<size_t>(capacity_, 1)) {}
+
+        void push(T value)
+        {
+            if (queue.size() == capacity)
+            {
+                queue.pop();
+            }
+            queue.push(value);
+        }
+
+        // Advances the window by a whole chunk. Only the last capacity values of the chunk can
+        // remain in the window, and the top two of the appended values take one vectorized pass.
+        void push(std::span<T const> values)
+        {
+            if (values.size() >= capacity)
+            {
+                queue.clear();
+                values = values.last(capacity);
+            }
+            queue.push(values);
+            if (queue.size() > capacity)
+            {
+                queue.pop(queue.size() - capacity);
+            }
+        }
+
+        // Top two of the values in the window, TRes{} if it is empty
+        TRes top_two() const { return detail::finish(queue.top_two()); }
+
+        size_t size() const { return queue.size(); }
+        void clear() { queue.clear(); }
+
+    private:
+        size_t capacity;
+        detail::TWindowQueue<T, Compare, detail::TNoStamp> queue;
+    };
+
+    // Top two of the values of a stream whose time stamps lie in (now - duration, now], where now
+    // is the latest time stamp passed to push or advance. Time stamps must not decrease.
+    template <typename T = int32_t, typename Compare = Less<T>, typename Clock = std::chrono::steady_clock>
+    class TTimeWindow
+    {
+    public:
+        using TRes = TBasicResult<T, Compare>;
+        using TTimePoint = typename Clock::time_point;
+
+        explicit TTimeWindow(typename Clock::duration duration_) : duration(duration_) {}
+
+        void push(TTimePoint time, T value)
+        {
+            queue.push(value, time);
+            advance(time);
+        }
+
+        // Values with their time stamps, e.g. a chunk read from a sensor. Throws
+        // std::invalid_argument if the spans differ in size.
+        void push(std::span<TTimePoint const> times, std::span<T const> values)
+        {
+            if (times.size() != values.size())
+            {
+                throw std::invalid_argument("TTimeWindow: " + std::to_string(times.size()) + " time stamps but " + std::to_string(values.size()) + " values");
+            }
+            if (values.empty())
+            {
+                return;
+            }
+            // values that are already outside of the window at the end of the chunk are skipped
+            auto const first = std::upper_bound(times.begin(), times.begin() + values.size(), times[values.size() - 1] - duration) - times.begin();
+            queue.push(values.subspan(first), times.subspan(first, values.size() - first));
+            advance(times[values.size() - 1]);
+        }
+
+        // Removes the values that are too old at now
+        void advance(TTimePoint now)
+        {
+            while (!queue.empty() && queue.oldest_stamp() <= now - duration)
+            {
+                queue.pop();
+            }
+        }
+
+        TRes top_two() const { return detail::finish(queue.top_two()); }
+
+        size_t size() const { return queue.size(); }
+        void clear() { queue.clear(); }
+
+    private:
+        typename Clock::duration duration;
+        detail::TWindowQueue<T, Compare, TTimePoint> queue;
+    };
+}
@@ -1,17 +1,71 @@
 // Comparison of several solutions for finding the two largest integers in a vector of ints
 //
+#include <array>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <span>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "accumulator.h"
 #include "algorithms.h"
+#include "arg_top_two.h"
+#include "backends.h"
+#include "batch.h"
+#include "benchmark.h"
+#include "column_file.h"
+#include "dispatch.h"
+#include "file_reduce.h"
+#include "fixed_size.h"
+#include "fused.h"
+#include "grouped.h"
+#include "load_generator.h"
+#include "select.h"
+#include "shared_reduce.h"
+#include "sliding_window.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "top_k.h"
+#include "tournament_tree.h"
+#include "workloads.h"
+
+template <typename T, typename Compare>
+std::ostream& operator<<(std::ostream& os, const top_two::TBasicResult<T, Compare>& result)
+{
+    os << "largest: " << +result.largest << ", second largest: " << +result.second_largest;
+    return os;
+}
 
-std::ostream& operator<<(std::ostream& os, const top_two::TResult& result)
+template <typename T, typename Compare>
+std::ostream& operator<<(std::ostream& os, const top_two::TBasicArgResult<T, Compare>& result)
 {
     os << "largest: " << result.largest << ", second largest: " << result.second_largest;
     return os;
 }
 
-bool check(const top_two::TResult& expected, const top_two::TResult& actual)
+template <size_t K, typename T, typename Compare>
+std::ostream& operator<<(std::ostream& os, const top_two::TTopK<K, T, Compare>& result)
+{
+    os << "values:";
+    for (auto value : result.values)
+    {
+        os << " " << +value;
+    }
+    return os;
+}
+
+template <typename TRes>
+bool check(const TRes& expected, const TRes& actual)
 {
     const bool result = (expected == actual);
     if (result)
@@ -46,35 +100,1199 @@ void test(const std::string& algorithm_name, F algorithm_callable)
     std::vector<int32_t> const all_one{1, 1, 1, 1, 1};
     top_two::TResult const all_one_expected{1, 1};
 
+    std::vector<int32_t> random_large(1'003);
+    std::iota(random_large.begin(), random_large.end(), -500);
+    std::shuffle(random_large.begin(), random_large.end(), std::mt19937{19937});
+    top_two::TResult const random_large_expected{501, 502};
+
     std::cout << algorithm_name << "/trivial: "; check(trivial_expected, algorithm_callable(trivial));
     std::cout << algorithm_name << "/trivial_inverted: "; check(trivial_inverted_expected, algorithm_callable(trivial_inverted));
     std::cout << algorithm_name << "/random_odd: "; check(random_odd_expected, algorithm_callable(random_odd));
     std::cout << algorithm_name << "/random_even: "; check(random_even_expected, algorithm_callable(random_even));
     std::cout << algorithm_name << "/all_zero: "; check(all_zero_expected, algorithm_callable(all_zero));
     std::cout << algorithm_name << "/all_one: "; check(all_one_expected, algorithm_callable(all_one));
+    std::cout << algorithm_name << "/random_large: "; check(random_large_expected, algorithm_callable(random_large));
+}
+
+template <size_t K>
+top_two::TTopK<K> top_k_expected(std::vector<int32_t> values)
+{
+    top_two::TTopK<K> expected;
+    std::sort(values.begin(), values.end());
+    auto const n = std::min(K, values.size());
+    std::copy(values.end() - n, values.end(), expected.values.end() - n);
+    return expected;
+}
+
+template <size_t K>
+void test_top_k()
+{
+    std::vector<std::pair<std::string, std::vector<int32_t>>> inputs{
+        {"trivial", {0, 1, 2, 3, 4}},
+        {"trivial_inverted", {4, 3, 2, 1, 0}},
+        {"random_even", {6, 2, 8, 4, 3, 9, 1, 2, 4, 7}},
+        {"all_one", {1, 1, 1, 1, 1}},
+        {"random_large", std::vector<int32_t>(1'003)}};
+
+    auto& random_large = inputs.back().second;
+    std::iota(random_large.begin(), random_large.end(), -500);
+    std::shuffle(random_large.begin(), random_large.end(), std::mt19937{19937});
+
+    std::string const prefix = "top_k<" + std::to_string(K) + ">/";
+    for (auto const& [input_name, values] : inputs)
+    {
+        auto const expected = top_k_expected<K>(values);
+        std::cout << prefix << "sequential::accumulate/" << input_name << ": "; check(expected, top_two::top_k::sequential::accumulate<K>(values));
+        std::cout << prefix << "sequential::transform_reduce/" << input_name << ": "; check(expected, top_two::top_k::sequential::transform_reduce<K>(values));
+        std::cout << prefix << "parallel::reduce/" << input_name << ": "; check(expected, top_two::top_k::parallel::reduce<K>(values));
+        std::cout << prefix << "parallel::transform_reduce/" << input_name << ": "; check(expected, top_two::top_k::parallel::transform_reduce<K>(values));
+        std::cout << prefix << "parallel::reduce/span/" << input_name << ": "; check(expected, top_two::top_k::parallel::reduce<K, int32_t>(std::span<int32_t const>(values)));
+    }
+}
+
+template <size_t... Ks>
+void test_top_k(std::index_sequence<Ks...>)
+{
+    (test_top_k<Ks + 1>(), ...);
+}
+
+template <typename T, typename Compare = top_two::Less<T>>
+void test_element_type(const std::string& type_name)
+{
+    using TRes = top_two::TBasicResult<T, Compare>;
+
+    std::vector<std::pair<std::string, std::vector<T>>> inputs{
+        {"trivial", {T(0), T(1), T(2), T(3), T(4)}},
+        {"extremes", {std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest(), T(5), std::numeric_limits<T>::max(), T(0)}},
+        {"random_large", std::vector<T>(200)}};
+
+    auto& random_large = inputs.back().second;
+    std::iota(random_large.begin(), random_large.end(), T(0));
+    std::shuffle(random_large.begin(), random_large.end(), std::mt19937{19937});
+
+    for (auto const& [input_name, values] : inputs)
+    {
+        auto sorted = values;
+        std::sort(sorted.begin(), sorted.end(), Compare{});
+        TRes const expected{sorted[sorted.size() - 2], sorted[sorted.size() - 1]};
+
+        auto const run = [&](const std::string& algorithm_name, auto algorithm_callable)
+        {
+            std::cout << type_name << "/" << algorithm_name << "/" << input_name << ": "; check(expected, algorithm_callable(values));
+        };
+        run("sequential::sort", top_two::sequential::sort<T, Compare>);
+        run("sequential::nth_element", top_two::sequential::nth_element<T, Compare>);
+        run("sequential::max_element", top_two::sequential::max_element<T, Compare>);
+        run("sequential::max_element_ben_deane", top_two::sequential::max_element_ben_deane<T, Compare>);
+        run("sequential::accumulate", top_two::sequential::accumulate<T, Compare>);
+        run("sequential::accumulate_branchless", top_two::sequential::accumulate_branchless<T, Compare>);
+        run("sequential::accumulate_adaptive", top_two::sequential::accumulate_adaptive<T, Compare>);
+        run("sequential::transform_reduce", top_two::sequential::transform_reduce<T, Compare>);
+        run("parallel::sort", top_two::parallel::sort<T, Compare>);
+        run("parallel::nth_element", top_two::parallel::nth_element<T, Compare>);
+        run("parallel::max_element", top_two::parallel::max_element<T, Compare>);
+        run("parallel::max_element_ben_deane", top_two::parallel::max_element_ben_deane<T, Compare>);
+        run("parallel::reduce", top_two::parallel::reduce<T, Compare>);
+        run("parallel::transform_reduce", top_two::parallel::transform_reduce<T, Compare>);
+        run("top_k<2>::accumulate", [](auto const& v) { auto const top = top_two::top_k::sequential::accumulate<2, T, Compare>(v); return TRes{top.values[0], top.values[1]}; });
+
+        if constexpr (std::is_same_v<Compare, top_two::Less<T>>)
+        {
+            for (auto isa : {top_two::simd::Isa::scalar, top_two::simd::Isa::sse41, top_two::simd::Isa::avx2, top_two::simd::Isa::avx512})
+            {
+                if (top_two::simd::is_supported(isa))
+                {
+                    run(std::string("simd::accumulate/") + top_two::simd::to_string(isa), [isa](auto const& v) { return top_two::simd::accumulate(v, isa); });
+                }
+            }
+        }
+    }
+}
+
+template <typename T, top_two::NanPolicy Policy>
+void test_nan_policy(const std::string& policy_name, std::vector<T> const& values, top_two::TBasicResult<T, top_two::Less<T, Policy>> const& expected)
+{
+    using Compare = top_two::Less<T, Policy>;
+
+    auto const run = [&](const std::string& algorithm_name, auto algorithm_callable)
+    {
+        std::cout << "nan_" << policy_name << "/" << algorithm_name << ": "; check(expected, algorithm_callable(values));
+    };
+    run("sequential::sort", top_two::sequential::sort<T, Compare>);
+    run("sequential::nth_element", top_two::sequential::nth_element<T, Compare>);
+    run("sequential::max_element", top_two::sequential::max_element<T, Compare>);
+    run("sequential::max_element_ben_deane", top_two::sequential::max_element_ben_deane<T, Compare>);
+    run("sequential::accumulate", top_two::sequential::accumulate<T, Compare>);
+    run("sequential::accumulate_branchless", top_two::sequential::accumulate_branchless<T, Compare>);
+    run("sequential::accumulate_adaptive", top_two::sequential::accumulate_adaptive<T, Compare>);
+    run("sequential::transform_reduce", top_two::sequential::transform_reduce<T, Compare>);
+    run("parallel::sort", top_two::parallel::sort<T, Compare>);
+    run("parallel::nth_element", top_two::parallel::nth_element<T, Compare>);
+    run("parallel::max_element", top_two::parallel::max_element<T, Compare>);
+    run("parallel::max_element_ben_deane", top_two::parallel::max_element_ben_deane<T, Compare>);
+    run("parallel::reduce", top_two::parallel::reduce<T, Compare>);
+    run("parallel::transform_reduce", top_two::parallel::transform_reduce<T, Compare>);
+}
+
+struct TRecord
+{
+    int64_t id;
+    float score;
+    int32_t payload[2];
+};
+
+void test_arg_top_two()
+{
+    std::vector<std::pair<std::string, std::vector<float>>> inputs{
+        {"trivial", {0, 1, 2, 3, 4}},
+        {"ties", {5, 7, 7, 3, 7}},
+        {"all_one", {1, 1, 1, 1, 1}},
+        {"random_large", std::vector<float>(200'003)}};
+
+    auto& random_large = inputs.back().second;
+    std::iota(random_large.begin(), random_large.end(), 0.0f);
+    std::shuffle(random_large.begin(), random_large.end(), std::mt19937{19937});
+
+    for (auto const& [input_name, scores] : inputs)
+    {
+        // reference: stable sort of the positions by descending score
+        std::vector<size_t> positions(scores.size());
+        std::iota(positions.begin(), positions.end(), size_t{0});
+        std::stable_sort(positions.begin(), positions.end(), [&scores](size_t lhs, size_t rhs) { return scores[lhs] > scores[rhs]; });
+        top_two::TBasicArgResult<float> const expected{positions[1], scores[positions[1]], positions[0], scores[positions[0]]};
+
+        std::vector<TRecord> records(scores.size());
+        for (size_t i = 0; i < scores.size(); ++i)
+        {
+            records[i] = {static_cast<int64_t>(i), scores[i], {0, 0}};
+        }
+
+        std::cout << "arg_top_two/sequential::accumulate/aos/" << input_name << ": "; check(expected, top_two::arg_top_two::sequential::accumulate(records, &TRecord::score));
+        std::cout << "arg_top_two/sequential::accumulate/soa/" << input_name << ": "; check(expected, top_two::arg_top_two::sequential::accumulate(scores));
+        std::cout << "arg_top_two/sequential::transform_reduce/aos/" << input_name << ": "; check(expected, top_two::arg_top_two::sequential::transform_reduce(records, &TRecord::score));
+        std::cout << "arg_top_two/sequential::transform_reduce/soa/" << input_name << ": "; check(expected, top_two::arg_top_two::sequential::transform_reduce(scores));
+        std::cout << "arg_top_two/parallel::reduce/aos/" << input_name << ": "; check(expected, top_two::arg_top_two::parallel::reduce(records, [](TRecord const& record) { return record.score; }));
+        std::cout << "arg_top_two/parallel::reduce/soa/" << input_name << ": "; check(expected, top_two::arg_top_two::parallel::reduce(scores));
+        std::cout << "arg_top_two/parallel::transform_reduce/aos/" << input_name << ": "; check(expected, top_two::arg_top_two::parallel::transform_reduce(records, &TRecord::score));
+        std::cout << "arg_top_two/parallel::transform_reduce/soa/" << input_name << ": "; check(expected, top_two::arg_top_two::parallel::transform_reduce(scores));
+        std::cout << "arg_top_two/parallel::reduce/span/" << input_name << ": "; check(expected, top_two::arg_top_two::parallel::reduce<float>(std::span<float const>(scores)));
+    }
+}
+
+template <typename T>
+void test_batch(const std::string& type_name)
+{
+    // ragged lengths including empty, single-element and long vectors
+    std::mt19937 rng(19937);
+    std::vector<size_t> offsets{0};
+    std::vector<T> values;
+    for (size_t vector = 0; vector < 203; ++vector)
+    {
+        auto const length = vector % 50 == 7 ? size_t{700} : rng() % 40;
+        for (size_t i = 0; i < length; ++i)
+        {
+            values.push_back(static_cast<T>(rng() % 100));
+        }
+        offsets.push_back(values.size());
+    }
+
+    std::vector<top_two::TBasicResult<T>> expected;
+    for (size_t vector = 0; vector + 1 < offsets.size(); ++vector)
+    {
+        std::vector<T> const single(values.begin() + offsets[vector], values.begin() + offsets[vector + 1]);
+        expected.push_back(top_two::sequential::accumulate<T>(single));
+    }
+
+    auto const check_all = [&expected](const std::string& name, std::vector<top_two::TBasicResult<T>> const& actual)
+    {
+        std::cout << name << ": "; check(true, expected == actual);
+    };
+
+    for (auto isa : {top_two::simd::Isa::scalar, top_two::simd::Isa::sse41, top_two::simd::Isa::avx2, top_two::simd::Isa::avx512})
+    {
+        if (top_two::simd::is_supported(isa))
+        {
+            std::vector<top_two::TBasicResult<T>> results(expected.size());
+            top_two::batch::sequential::accumulate<T>(values, offsets, results, isa);
+            check_all("batch/" + type_name + "/sequential::accumulate/" + top_two::simd::to_string(isa), results);
+        }
+    }
+
+    top_two::TThreadPool pool({4});
+    std::vector<top_two::TBasicResult<T>> results(expected.size());
+    top_two::batch::parallel::reduce<T>(values, offsets, results, pool, 1);
+    check_all("batch/" + type_name + "/parallel::reduce", results);
+    check_all("batch/" + type_name + "/parallel::reduce/default_pool", top_two::batch::parallel::reduce<T>(values, offsets));
+}
+
+template <size_t NFanOut>
+void test_tournament_tree(size_t size)
+{
+    std::vector<int32_t> values(size);
+    std::iota(values.begin(), values.end(), -static_cast<int32_t>(size / 2));
+    std::mt19937 rng(19937);
+    std::shuffle(values.begin(), values.end(), rng);
+
+    top_two::TTournamentTree<int32_t, top_two::Less<int32_t>, NFanOut> tree(values);
+    std::string const prefix = "tournament_tree<" + std::to_string(NFanOut) + ">/" + std::to_string(size) + "/";
+    std::cout << prefix << "build: "; check(top_two::sequential::accumulate<int32_t>(values), tree.top_two());
+
+    // point updates that replace, raise and lower the largest values
+    std::uniform_int_distribution<size_t> index_distribution(0, size - 1);
+    std::uniform_int_distribution<int32_t> value_distribution(-2 * static_cast<int32_t>(size), 2 * static_cast<int32_t>(size));
+    bool all_equal = true;
+    for (size_t i = 0; i < 1'000; ++i)
+    {
+        auto const index = i % 3 == 0 ? static_cast<size_t>(std::max_element(values.begin(), values.end()) - values.begin()) : index_distribution(rng);
+        values[index] = value_distribution(rng);
+        tree.update(index, values[index]);
+        all_equal = all_equal && top_two::sequential::accumulate<int32_t>(values) == tree.top_two();
+    }
+    std::cout << prefix << "update: "; check(true, all_equal);
+
+    using TUpdate = typename decltype(tree)::TUpdate;
+    std::vector<TUpdate> updates;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        updates.push_back({index_distribution(rng), value_distribution(rng)});
+    }
+    updates.push_back({updates.front().index, value_distribution(rng)});
+    for (auto const &update : updates)
+    {
+        values[update.index] = update.value;
+    }
+    tree.update(updates);
+    std::cout << prefix << "bulk_update: "; check(top_two::sequential::accumulate<int32_t>(values), tree.top_two());
+}
+
+template <typename Backend>
+void test_backend(const std::string& backend_name)
+{
+    test(backend_name + "/sort", top_two::parallel::sort<int32_t, top_two::Less<int32_t>, Backend>);
+    test(backend_name + "/nth_element", top_two::parallel::nth_element<int32_t, top_two::Less<int32_t>, Backend>);
+    test(backend_name + "/max_element", top_two::parallel::max_element<int32_t, top_two::Less<int32_t>, Backend>);
+    test(backend_name + "/max_element_ben_deane", top_two::parallel::max_element_ben_deane<int32_t, top_two::Less<int32_t>, Backend>);
+    test(backend_name + "/reduce", top_two::parallel::reduce<int32_t, top_two::Less<int32_t>, Backend>);
+    test(backend_name + "/transform_reduce", top_two::parallel::transform_reduce<int32_t, top_two::Less<int32_t>, Backend>);
+
+    // large enough to be split into one chunk per thread
+    std::vector<int32_t> values(200'003);
+    std::iota(values.begin(), values.end(), -100'000);
+    std::shuffle(values.begin(), values.end(), std::mt19937{19937});
+    top_two::TResult const expected{100'001, 100'002};
+    std::cout << backend_name << "/large/nth_element: "; check(expected, top_two::parallel::nth_element<int32_t, top_two::Less<int32_t>, Backend>(values));
+    std::cout << backend_name << "/large/max_element: "; check(expected, top_two::parallel::max_element<int32_t, top_two::Less<int32_t>, Backend>(values));
+    std::cout << backend_name << "/large/reduce: "; check(expected, top_two::parallel::reduce<int32_t, top_two::Less<int32_t>, Backend>(values));
+    std::cout << backend_name << "/large/transform_reduce: "; check(expected, top_two::parallel::transform_reduce<int32_t, top_two::Less<int32_t>, Backend>(values));
+    std::cout << backend_name << "/large/simd::reduce: "; check(expected, top_two::simd::reduce<int32_t, Backend>(values));
+
+    // the largest value starts the range of the first thread and must be counted once
+    auto largest_first = values;
+    std::iter_swap(largest_first.begin(), std::max_element(largest_first.begin(), largest_first.end()));
+    std::cout << backend_name << "/large/reduce/largest_first: "; check(expected, top_two::parallel::reduce<int32_t, top_two::Less<int32_t>, Backend>(largest_first));
+    std::cout << backend_name << "/large/transform_reduce/largest_first: "; check(expected, top_two::parallel::transform_reduce<int32_t, top_two::Less<int32_t>, Backend>(largest_first));
+
+    top_two::TTopK<2> const expected_top_k{{100'001, 100'002}};
+    std::cout << backend_name << "/large/top_k::reduce: "; check(expected_top_k, top_two::top_k::parallel::reduce<2, int32_t, top_two::Less<int32_t>, Backend>(values));
+    std::cout << backend_name << "/large/top_k::transform_reduce: "; check(expected_top_k, top_two::top_k::parallel::transform_reduce<2, int32_t, top_two::Less<int32_t>, Backend>(values));
+
+    auto const position = [&values](int32_t value) { return static_cast<size_t>(std::find(values.begin(), values.end(), value) - values.begin()); };
+    top_two::TArgResult const expected_arg{position(100'001), 100'001, position(100'002), 100'002};
+    using TIdentity = top_two::arg_top_two::Identity;
+    std::cout << backend_name << "/large/arg_top_two::reduce: "; check(expected_arg, top_two::arg_top_two::parallel::reduce<int32_t, TIdentity, top_two::Less<int32_t>, Backend>(values));
+    std::cout << backend_name << "/large/arg_top_two::transform_reduce: "; check(expected_arg, top_two::arg_top_two::parallel::transform_reduce<int32_t, TIdentity, top_two::Less<int32_t>, Backend>(values));
+
+    namespace fused = top_two::fused;
+    auto const stats = fused::parallel::transform_reduce<int32_t, fused::Max, fused::Count, fused::TopTwo>(values, Backend{});
+    std::cout << backend_name << "/large/fused::transform_reduce: ";
+    check(true, stats.template get<fused::Max>() == 100'002 && stats.template get<fused::Count>() == values.size() && stats.template get<fused::TopTwo>() == expected);
+
+    auto sorted = values;
+    Backend::sort(sorted.begin(), sorted.end(), std::less<>{});
+    std::cout << backend_name << "/large/sort: "; check(true, std::is_sorted(sorted.begin(), sorted.end()));
+
+    // select allocates in its tasks, which the unsequenced policies do not allow
+    if constexpr (!std::is_same_v<Backend, top_two::backend::ParUnseq> && !std::is_same_v<Backend, top_two::backend::Unseq>)
+    {
+        std::vector<int32_t> const expected_selected(sorted.end() - 1'000, sorted.end());
+        std::cout << backend_name << "/large/select: ";
+        check(true, expected_selected == top_two::top_k::parallel::select<int32_t, top_two::Less<int32_t>, Backend>(values, 1'000, top_two::top_k::Order::sorted));
+    }
+
+    // the element at nth is in place and the range is partitioned around it
+    auto selected = values;
+    auto const nth = selected.begin() + 10;
+    Backend::nth_element(selected.begin(), nth, selected.end(), std::less<>{});
+    std::cout << backend_name << "/large/nth_element_partition: ";
+    check(true, *nth == -99'990 && std::all_of(selected.begin(), nth, [nth](int32_t value) { return value <= *nth; }) &&
+                    std::all_of(nth, selected.end(), [nth](int32_t value) { return value >= *nth; }));
+}
+
+// Backends that run on n_threads threads must spread the chunks of simd::reduce, arg_top_two and
+// select over more than one of them, however few chunks there are
+template <typename Backend>
+void test_backend_workers(const std::string& backend_name, size_t n_threads)
+{
+    std::vector<std::thread::id> workers(2 * n_threads);
+    auto const n_distinct = [&workers]
+    {
+        auto sorted = workers;
+        std::sort(sorted.begin(), sorted.end());
+        return static_cast<size_t>(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+    };
+
+    auto const n_reduced = Backend::reduce_chunks(workers.size(), size_t{0}, std::plus<>{}, [&workers](size_t chunk)
+                                                  {
+                                                      workers[chunk] = std::this_thread::get_id();
+                                                      return size_t{1};
+                                                  });
+    std::cout << backend_name << "/reduce_chunks/workers: "; check(true, n_reduced == workers.size() && n_distinct() > 1);
+
+    std::fill(workers.begin(), workers.end(), std::thread::id{});
+    Backend::for_chunks(workers.size(), [&workers](size_t chunk) { workers[chunk] = std::this_thread::get_id(); });
+    std::cout << backend_name << "/for_chunks/workers: ";
+    check(true, std::find(workers.begin(), workers.end(), std::thread::id{}) == workers.end() && n_distinct() > 1);
+}
+
+template <typename T, typename Compare = top_two::Less<T>>
+void test_select(const std::string& input_name, std::vector<T> const& values)
+{
+    auto sorted = values;
+    std::sort(sorted.begin(), sorted.end(), Compare{});
+    for (size_t k : {size_t{0}, size_t{1}, size_t{100}, size_t{5'000}, values.size() - 1, values.size() + 1})
+    {
+        std::vector<T> const expected(sorted.end() - std::min(k, sorted.size()), sorted.end());
+        auto unsorted = top_two::top_k::parallel::select<T, Compare>(values, k);
+        std::sort(unsorted.begin(), unsorted.end(), Compare{});
+        std::cout << "select/" << input_name << "/" << k << ": "; check(true, expected == unsorted);
+        std::cout << "select/" << input_name << "/" << k << "/sorted: "; check(true, expected == top_two::top_k::parallel::select<T, Compare>(values, k, top_two::top_k::Order::sorted));
+    }
+}
+
+template <typename TKey, typename T, typename Compare = top_two::Less<T>>
+void test_grouped(const std::string& input_name, std::vector<TKey> const& keys, std::vector<T> const& values)
+{
+    using TGroups = top_two::grouped::TGroups<TKey, T, Compare>;
+    using TRes = top_two::TBasicResult<T, Compare>;
+
+    // the sorted values of every key
+    std::map<TKey, std::vector<T>> by_key;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        by_key[keys[i]].push_back(values[i]);
+    }
+    std::map<TKey, TRes> expected;
+    for (auto& [key, key_values] : by_key)
+    {
+        std::sort(key_values.begin(), key_values.end(), Compare{});
+        expected[key] = key_values.size() == 1 ? TRes{Compare::lowest(), key_values[0]} : TRes{key_values[key_values.size() - 2], key_values.back()};
+    }
+
+    auto const check_groups = [&](std::string const& name, TGroups const& groups)
+    {
+        std::map<TKey, TRes> actual;
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            actual[groups.keys[i]] = groups.results[i];
+        }
+        std::cout << "grouped/" << input_name << "/" << name << ": "; check(true, groups.size() == expected.size() && actual == expected);
+    };
+
+    top_two::TThreadPool pool(top_two::TPoolConfig{4});
+    check_groups("sequential::accumulate", top_two::grouped::sequential::accumulate<TKey, T, Compare>(keys, values));
+    check_groups("parallel::reduce_local", top_two::grouped::parallel::reduce_local<TKey, T, Compare>(keys, values, pool));
+    check_groups("parallel::reduce_partitioned", top_two::grouped::parallel::reduce_partitioned<TKey, T, Compare>(keys, values, pool));
+    check_groups("parallel::reduce_partitioned/0_bits", top_two::grouped::parallel::reduce_partitioned<TKey, T, Compare>(keys, values, pool, 0));
+    check_groups("parallel::reduce", top_two::grouped::parallel::reduce<TKey, T, Compare>(keys, values, pool));
+}
+
+template <typename T>
+void test_fused(const std::string& input_name, std::vector<T> const& values)
+{
+    namespace fused = top_two::fused;
+    using TFused = fused::TFused<T, fused::Min, fused::Max, fused::Sum, fused::Count, fused::TopTwo, fused::BottomTwo>;
+
+    // one pass per statistic
+    auto sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    auto const sum = std::accumulate(values.begin(), values.end(), fused::Sum::TState<T>{0});
+    top_two::TBasicResult<T> const top_two{sorted[sorted.size() - 2], sorted.back()};
+    top_two::TBasicResult<T, top_two::Greater<T>> const bottom_two{sorted[1], sorted[0]};
+
+    auto const check_all = [&](std::string const& name, TFused const& result)
+    {
+        std::string const prefix = "fused/" + input_name + "/" + name + "/";
+        std::cout << prefix << "min: "; check(sorted.front(), result.template get<fused::Min>());
+        std::cout << prefix << "max: "; check(sorted.back(), result.template get<fused::Max>());
+        std::cout << prefix << "sum: "; check(sum, result.template get<fused::Sum>());
+        std::cout << prefix << "count: "; check(values.size(), result.template get<fused::Count>());
+        std::cout << prefix << "top_two: "; check(top_two, result.template get<fused::TopTwo>());
+        std::cout << prefix << "bottom_two: "; check(bottom_two, result.template get<fused::BottomTwo>());
+    };
+
+    top_two::TThreadPool pool(top_two::TPoolConfig{4, 1'000});
+    check_all("sequential::accumulate", fused::sequential::accumulate<T, fused::Min, fused::Max, fused::Sum, fused::Count, fused::TopTwo, fused::BottomTwo>(values));
+    check_all("parallel::transform_reduce", fused::parallel::transform_reduce<T, fused::Min, fused::Max, fused::Sum, fused::Count, fused::TopTwo, fused::BottomTwo>(values));
+    check_all("parallel::reduce", fused::parallel::reduce<T, fused::Min, fused::Max, fused::Sum, fused::Count, fused::TopTwo, fused::BottomTwo>(values, pool));
+
+    // a subset of the statistics, in another order
+    auto const subset = fused::sequential::accumulate<T, fused::BottomTwo, fused::Count>(values);
+    std::cout << "fused/" << input_name << "/subset: "; check(true, subset.template get<fused::BottomTwo>() == bottom_two && subset.template get<fused::Count>() == values.size());
+}
+
+// Compares the window after every push or chunk with an accumulate over the last window values
+template <typename Compare = top_two::Less<int32_t>>
+void test_sliding_window(size_t capacity)
+{
+    using TRes = top_two::TBasicResult<int32_t, Compare>;
+    std::mt19937 rng(19937);
+    std::uniform_int_distribution<int32_t> value_distribution(-1'000, 1'000);
+    std::uniform_int_distribution<size_t> chunk_distribution(0, 2 * capacity + 3);
+
+    std::vector<int32_t> stream;
+    top_two::TSlidingWindow<int32_t, Compare> window(capacity);
+    auto const expected = [&]
+    {
+        auto const first = stream.size() - std::min(stream.size(), capacity);
+        return top_two::sequential::accumulate<int32_t, Compare>(std::span<int32_t const>(stream).subspan(first));
+    };
+
+    bool single_ok = true;
+    for (size_t i = 0; i < 5 * capacity + 10; ++i)
+    {
+        stream.push_back(value_distribution(rng));
+        window.push(stream.back());
+        single_ok &= window.top_two() == expected() && window.size() == std::min(stream.size(), capacity);
+    }
+    std::string const prefix = "sliding_window<" + std::to_string(capacity) + ">/";
+    std::cout << prefix << "push: "; check(true, single_ok);
+
+    bool chunk_ok = true;
+    for (size_t i = 0; i < 50; ++i)
+    {
+        std::vector<int32_t> chunk(chunk_distribution(rng));
+        std::generate(chunk.begin(), chunk.end(), [&] { return value_distribution(rng); });
+        stream.insert(stream.end(), chunk.begin(), chunk.end());
+        window.push(std::span<int32_t const>(chunk));
+        chunk_ok &= window.top_two() == expected() && window.size() == std::min(stream.size(), capacity);
+        // single values in between
+        stream.push_back(value_distribution(rng));
+        window.push(stream.back());
+        chunk_ok &= window.top_two() == expected();
+    }
+    std::cout << prefix << "push_chunk: "; check(true, chunk_ok);
+
+    window.clear();
+    std::cout << prefix << "clear: "; check(TRes{}, window.top_two());
+}
+
+void test_time_window()
+{
+    using TWindow = top_two::TTimeWindow<int32_t>;
+    using namespace std::chrono_literals;
+    std::mt19937 rng(19937);
+    std::uniform_int_distribution<int32_t> value_distribution(-1'000, 1'000);
+    std::uniform_int_distribution<int64_t> gap_distribution(0, 30);
+
+    std::vector<TWindow::TTimePoint> times;
+    std::vector<int32_t> values;
+    TWindow window(100ms);
+    auto const expected = [&](TWindow::TTimePoint now)
+    {
+        top_two::TResult result;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (times[i] > now - 100ms && times[i] <= now)
+            {
+                result = top_two::parallel::ReduceOp<int32_t>{}(result, values[i]);
+            }
+        }
+        return result;
+    };
+
+    TWindow::TTimePoint now{};
+    bool single_ok = true;
+    for (size_t i = 0; i < 1'000; ++i)
+    {
+        now += std::chrono::milliseconds(gap_distribution(rng));
+        times.push_back(now);
+        values.push_back(value_distribution(rng));
+        window.push(now, values.back());
+        single_ok &= window.top_two() == expected(now);
+    }
+    std::cout << "time_window/push: "; check(true, single_ok);
+
+    bool chunk_ok = true;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        auto const first = values.size();
+        for (size_t n = gap_distribution(rng); n > 0; --n)
+        {
+            now += std::chrono::milliseconds(gap_distribution(rng));
+            times.push_back(now);
+            values.push_back(value_distribution(rng));
+        }
+        window.push(std::span<TWindow::TTimePoint const>(times).subspan(first), std::span<int32_t const>(values).subspan(first));
+        chunk_ok &= window.top_two() == expected(now);
+    }
+    std::cout << "time_window/push_chunk: "; check(true, chunk_ok);
+
+    now += 99ms;
+    window.advance(now);
+    std::cout << "time_window/advance: "; check(expected(now), window.top_two());
+    now += 1ms;
+    window.advance(now);
+    std::cout << "time_window/advance_past_all: "; check(true, window.size() == 0 && window.top_two() == top_two::TResult{});
+
+    bool thrown = false;
+    try
+    {
+        window.push(std::span<TWindow::TTimePoint const>(times).first(2), std::span<int32_t const>(values).first(3));
+    }
+    catch (std::invalid_argument const&)
+    {
+        thrown = true;
+    }
+    std::cout << "time_window/mismatched_spans: "; check(true, thrown && window.size() == 0);
+}
+
+template <size_t N, typename T = int32_t, typename Compare = top_two::Less<T>>
+void test_fixed_size(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int32_t> value_distribution(-100, 100);
+    bool ok = true;
+    for (size_t trial = 0; trial < 10; ++trial)
+    {
+        std::array<T, N> values;
+        std::generate(values.begin(), values.end(), [&] { return static_cast<T>(value_distribution(rng)); });
+        auto const expected = top_two::sequential::accumulate<T, Compare>(std::span<T const>(values));
+        ok &= expected == top_two::fixed_size::accumulate<T, Compare>(values);
+        ok &= expected == top_two::fixed_size::accumulate<T, Compare>(std::span<T const, N>(values));
+    }
+    std::cout << "fixed_size/accumulate<" << N << ">: "; check(true, ok);
+}
+
+template <size_t... Ns>
+void test_fixed_size(std::index_sequence<Ns...>)
+{
+    std::mt19937 rng(19937);
+    (test_fixed_size<Ns>(rng), ...);
 }
 
 int32_t main()
 {
     std::cout << "sequential\n\n";
     {
-        test("sort", top_two::sequential::sort);
-        test("nth_element", top_two::sequential::nth_element);
-        test("max_element", top_two::sequential::max_element);
-        test("max_element_ben_deane", top_two::sequential::max_element_ben_deane);
-        test("accumulate", top_two::sequential::accumulate);
-        test("transform_reduce", top_two::sequential::transform_reduce);
+        test("sort", top_two::sequential::sort<int32_t>);
+        test("nth_element", top_two::sequential::nth_element<int32_t>);
+        test("max_element", top_two::sequential::max_element<int32_t>);
+        test("max_element_ben_deane", top_two::sequential::max_element_ben_deane<int32_t>);
+        test("accumulate", top_two::sequential::accumulate<int32_t>);
+        test("accumulate_branchless", top_two::sequential::accumulate_branchless<int32_t>);
+        test("accumulate_adaptive", top_two::sequential::accumulate_adaptive<int32_t>);
+        test("transform_reduce", top_two::sequential::transform_reduce<int32_t>);
+
+        // longer than the sampled prefix, so that both kernels of accumulate_adaptive are taken
+        std::vector<int32_t> ascending(10'000);
+        std::iota(ascending.begin(), ascending.end(), 0);
+        auto shuffled = ascending;
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{19937});
+        std::cout << "accumulate_adaptive/ascending: "; check(top_two::TResult{9'998, 9'999}, top_two::sequential::accumulate_adaptive<int32_t>(ascending));
+        std::cout << "accumulate_adaptive/shuffled: "; check(top_two::TResult{9'998, 9'999}, top_two::sequential::accumulate_adaptive<int32_t>(shuffled));
     }  
 
     std::cout << "\n\nparallel\n\n";
     {
-        test("sort", top_two::parallel::sort);
-        test("nth_element", top_two::parallel::nth_element);
-        test("max_element", top_two::parallel::max_element);
-        test("max_element_ben_deane", top_two::parallel::max_element_ben_deane);
-        test("reduce", top_two::parallel::reduce);
-        test("transform_reduce", top_two::parallel::transform_reduce);
+        test("sort", top_two::parallel::sort<int32_t>);
+        test("nth_element", top_two::parallel::nth_element<int32_t>);
+        test("max_element", top_two::parallel::max_element<int32_t>);
+        test("max_element_ben_deane", top_two::parallel::max_element_ben_deane<int32_t>);
+        test("reduce", top_two::parallel::reduce<int32_t>);
+        test("transform_reduce", top_two::parallel::transform_reduce<int32_t>);
     }      
 
+    std::cout << "\n\nbackends\n\n";
+    {
+        // more threads than cores, so that the chunked backends split their input on every host
+        top_two::backend::set_n_threads(4);
+        test_backend<top_two::backend::ParUnseq>("std::par_unseq");
+        test_backend<top_two::backend::Par>("std::par");
+        test_backend<top_two::backend::Unseq>("std::unseq");
+        test_backend<top_two::backend::Threads>("std::thread");
+#ifdef _OPENMP
+        test_backend<top_two::backend::OpenMP>("openmp");
+        test_backend<top_two::backend::Gnu>("gnu_parallel");
+#endif
+        // the std policies run on as many threads as the scheduler of the standard library
+        // decides, which is one on a single core host
+        test_backend_workers<top_two::backend::Threads>("std::thread", 4);
+#ifdef _OPENMP
+        test_backend_workers<top_two::backend::OpenMP>("openmp", 4);
+        test_backend_workers<top_two::backend::Gnu>("gnu_parallel", 4);
+#endif
+        top_two::backend::set_n_threads(0);
+    }
+
+    std::cout << "\n\nthread pool\n\n";
+    {
+        top_two::TThreadPool pool({4, 2, true});
+        test("pool::reduce", [&pool](auto const &values) { return top_two::parallel::pool::reduce<int32_t>(values, pool); });
+        test("pool::transform_reduce", [&pool](auto const &values) { return top_two::parallel::pool::transform_reduce<int32_t>(values, pool); });
+        test("pool::reduce/default_pool", [](auto const &values) { return top_two::parallel::pool::reduce<int32_t>(values); });
+
+        std::vector<int32_t> first_touched(100'003);
+        pool.for_each_block(first_touched.size(), [&first_touched](size_t first, size_t last) { std::iota(first_touched.begin() + first, first_touched.begin() + last, static_cast<int32_t>(first)); }, 1'000);
+        std::cout << "pool::for_each_block: "; check(top_two::TResult{100'001, 100'002}, top_two::parallel::pool::reduce<int32_t>(first_touched, pool, 1'000));
+        std::cout << "pool::reduce/greater: "; check(top_two::TBasicResult<int32_t, top_two::Greater<int32_t>>{1, 0}, top_two::parallel::pool::reduce<int32_t, top_two::Greater<int32_t>>(first_touched, pool, 1'000));
+    }
+
+    std::cout << "\n\nbatch\n\n";
+    {
+        test_batch<int32_t>("int32");
+        test_batch<int16_t>("int16");
+        test_batch<uint8_t>("uint8");
+        test_batch<double>("double");
+
+        std::vector<int32_t> const values{1, 2, 3, 4};
+        std::vector<size_t> const offsets{0, 2, 4};
+        std::vector<top_two::TResult> too_few(1);
+        bool thrown = false;
+        try
+        {
+            top_two::batch::sequential::accumulate<int32_t>(values, offsets, too_few);
+        }
+        catch (std::invalid_argument const&)
+        {
+            thrown = true;
+        }
+        std::cout << "batch/sequential::accumulate/mismatched_results: "; check(true, thrown);
+
+        thrown = false;
+        try
+        {
+            top_two::batch::parallel::reduce<int32_t>(values, offsets, too_few);
+        }
+        catch (std::invalid_argument const&)
+        {
+            thrown = true;
+        }
+        std::cout << "batch/parallel::reduce/mismatched_results: "; check(true, thrown);
+    }
+
+    std::cout << "\n\ngrouped\n\n";
+    {
+        std::mt19937 rng(19937);
+        std::uniform_int_distribution<int32_t> value_distribution(-1'000'000, 1'000'000);
+        std::vector<int32_t> values(200'003);
+        std::generate(values.begin(), values.end(), [&] { return value_distribution(rng); });
+
+        // few groups take the thread-local tables, many groups the partitioned path
+        for (int32_t n_keys : {1, 7, 1'000, 100'000})
+        {
+            std::uniform_int_distribution<int32_t> key_distribution(0, n_keys - 1);
+            std::vector<int32_t> keys(values.size());
+            std::generate(keys.begin(), keys.end(), [&] { return key_distribution(rng); });
+            test_grouped("keys_" + std::to_string(n_keys), keys, values);
+        }
+
+        std::vector<int64_t> distinct_keys(values.size());
+        std::iota(distinct_keys.begin(), distinct_keys.end(), int64_t{-100'000});
+        test_grouped("distinct_int64_keys", distinct_keys, values);
+
+        std::vector<int32_t> few_keys{3, 1, 3, 3, 2, 1};
+        std::vector<double> few_values{1.5, -2.0, 7.0, 7.0, 0.5, -1.0};
+        test_grouped("small", few_keys, few_values);
+        test_grouped<int32_t, double, top_two::Greater<double>>("small_greater", few_keys, few_values);
+        test_grouped("empty", std::vector<int32_t>{}, std::vector<int32_t>{});
+
+        bool thrown = false;
+        try
+        {
+            top_two::grouped::sequential::accumulate<int32_t, int32_t>(few_keys, std::vector<int32_t>{1});
+        }
+        catch (std::invalid_argument const&)
+        {
+            thrown = true;
+        }
+        std::cout << "grouped/mismatched_columns: "; check(true, thrown);
+    }
+
+    std::cout << "\n\nfused\n\n";
+    {
+        std::vector<int32_t> values(300'007);
+        std::iota(values.begin(), values.end(), -150'000);
+        std::shuffle(values.begin(), values.end(), std::mt19937{19937});
+        test_fused("int32", values);
+        test_fused("int16", std::vector<int16_t>(values.begin(), values.begin() + 10'000));
+        test_fused("double", std::vector<double>(values.begin(), values.end()));
+        test_fused("short", std::vector<int32_t>{5, -3});
+
+        auto const empty = top_two::fused::sequential::accumulate<int32_t, top_two::fused::Min, top_two::fused::Count>(std::vector<int32_t>{});
+        std::cout << "fused/empty: "; check(true, empty.get<top_two::fused::Min>() == std::numeric_limits<int32_t>::max() && empty.get<top_two::fused::Count>() == 0);
+    }
+
+    std::cout << "\n\nin place\n\n";
+    {
+        top_two::TScratchBuffer<int32_t> scratch;
+        test("sequential::sort_in_place", [&scratch](auto const &values) { return top_two::sequential::sort_in_place<int32_t>(scratch.copy_of(values)); });
+        test("sequential::nth_element_in_place", [&scratch](auto const &values) { return top_two::sequential::nth_element_in_place<int32_t>(scratch.copy_of(values)); });
+        test("sequential::max_element_ben_deane_in_place", [&scratch](auto const &values) { return top_two::sequential::max_element_ben_deane_in_place<int32_t>(scratch.copy_of(values)); });
+        test("parallel::sort_in_place", [&scratch](auto const &values) { return top_two::parallel::sort_in_place<int32_t>(scratch.copy_of(values)); });
+        test("parallel::nth_element_in_place", [&scratch](auto const &values) { return top_two::parallel::nth_element_in_place<int32_t>(scratch.copy_of(values)); });
+        test("parallel::max_element_ben_deane_in_place", [&scratch](auto const &values) { return top_two::parallel::max_element_ben_deane_in_place<int32_t>(scratch.copy_of(values)); });
+
+        int32_t const c_array[]{6, 2, 8, 4, 3, 9, 1, 2, 4, 7};
+        std::cout << "span/c_array: "; check(top_two::TResult{8, 9}, top_two::sequential::max_element<int32_t>(c_array));
+    }
+
+    std::cout << "\n\naccumulator\n\n";
+    {
+        // chunks of 3 values are distributed alternately over two accumulators, which are merged at the end
+        auto const accumulate_chunked = [](auto const &values)
+        {
+            top_two::TopTwoAccumulator even, odd;
+            std::span<int32_t const> const all{values};
+            for (size_t first = 0, chunk = 0; first < all.size(); first += 3, ++chunk)
+            {
+                auto const part = all.subspan(first, std::min<size_t>(3, all.size() - first));
+                (chunk % 2 == 0 ? even : odd).push(part);
+            }
+            even.merge(odd);
+            return even.result();
+        };
+        test("accumulator/chunked", accumulate_chunked);
+
+        auto const accumulate_values = [](auto const &values)
+        {
+            top_two::TopTwoAccumulator accumulator;
+            for (auto value : values)
+            {
+                accumulator.push(value);
+            }
+            return accumulator.result();
+        };
+        test("accumulator/values", accumulate_values);
+
+        top_two::TopTwoAccumulator<int32_t, top_two::Greater<int32_t>> smallest;
+        smallest.push(std::vector<int32_t>{6, 2, 8, 4, 3, 9, 1, 2, 4, 7});
+        std::cout << "accumulator/greater: "; check(top_two::TBasicResult<int32_t, top_two::Greater<int32_t>>{2, 1}, smallest.result());
+    }
+
+    std::cout << "\n\nelement types\n\n";
+    {
+        test_element_type<int8_t>("int8");
+        test_element_type<uint8_t>("uint8");
+        test_element_type<int16_t>("int16");
+        test_element_type<uint16_t>("uint16");
+        test_element_type<uint32_t>("uint32");
+        test_element_type<int64_t>("int64");
+        test_element_type<uint64_t>("uint64");
+        test_element_type<float>("float");
+        test_element_type<double>("double");
+        test_element_type<int32_t, top_two::Greater<int32_t>>("int32_greater");
+        test_element_type<double, top_two::Greater<double>>("double_greater");
+
+        auto const nan = std::numeric_limits<double>::quiet_NaN();
+        auto const lowest = top_two::Less<double>::lowest();
+        std::vector<double> const with_nan{1.0, nan, 3.0, 2.0};
+        test_nan_policy<double, top_two::NanPolicy::ignore>("ignore", with_nan, {2.0, 3.0});
+        test_nan_policy<double, top_two::NanPolicy::largest>("largest", with_nan, {3.0, nan});
+        test_nan_policy<double, top_two::NanPolicy::propagate>("propagate", with_nan, {nan, nan});
+        // fewer than two values that are not NaN
+        test_nan_policy<double, top_two::NanPolicy::ignore>("ignore/one_value", {nan, 1.0}, {lowest, 1.0});
+        test_nan_policy<double, top_two::NanPolicy::ignore>("ignore/all_nan", {nan, nan, nan}, {lowest, lowest});
+        test_nan_policy<double, top_two::NanPolicy::propagate>("propagate/all_nan", {nan, nan, nan}, {nan, nan});
+    }
+
+    std::cout << "\n\narg_top_two\n\n";
+    {
+        test_arg_top_two();
+    }
+
+    std::cout << "\n\ntop_k\n\n";
+    {
+        test_top_k(std::make_index_sequence<16>{});
+    }
+
+    std::cout << "\n\nfixed size\n\n";
+    {
+        test_fixed_size(std::index_sequence<0, 1, 2, 3, 5, 8, 10, 16, 17, 100, 128, 255, 256, 257, 300>{});
+        std::mt19937 rng(19937);
+        test_fixed_size<64, int32_t, top_two::Greater<int32_t>>(rng);
+        test_fixed_size<33, double>(rng);
+        test_fixed_size<20, uint8_t>(rng);
+
+        double const nan = std::numeric_limits<double>::quiet_NaN();
+        std::array<double, 5> const with_nan{1.0, nan, 3.0, 2.0, -1.0};
+        std::cout << "fixed_size/nan_ignore: "; check(top_two::TBasicResult<double>{2.0, 3.0}, top_two::fixed_size::accumulate(with_nan));
+        using TPropagate = top_two::Less<double, top_two::NanPolicy::propagate>;
+        std::cout << "fixed_size/nan_propagate: "; check(top_two::TBasicResult<double, TPropagate>{nan, nan}, top_two::fixed_size::accumulate<double, TPropagate>(with_nan));
+        // fewer than two values that are not NaN
+        float const nan_float = std::numeric_limits<float>::quiet_NaN();
+        float const lowest_float = top_two::Less<float>::lowest();
+        std::cout << "fixed_size/nan_ignore/one_value: "; check(top_two::TBasicResult<float>{lowest_float, 1.f}, top_two::fixed_size::accumulate(std::array<float, 2>{nan_float, 1.f}));
+        std::cout << "fixed_size/nan_ignore/all_nan: "; check(top_two::TBasicResult<float>{lowest_float, lowest_float}, top_two::fixed_size::accumulate(std::array<float, 3>{nan_float, nan_float, nan_float}));
+
+        // evaluated by the compiler
+        constexpr std::array<int32_t, 10> features{4, 9, -3, 7, 9, 0, 2, 8, 1, 5};
+        static_assert(top_two::fixed_size::accumulate(features) == top_two::TResult{9, 9});
+        static_assert(top_two::fixed_size::accumulate<int32_t, top_two::Greater<int32_t>>(features) == top_two::TBasicResult<int32_t, top_two::Greater<int32_t>>{0, -3});
+        std::cout << "fixed_size/constexpr: "; check(true, true);
+    }
+
+    std::cout << "\n\nselect\n\n";
+    {
+        std::vector<int32_t> shuffled(300'007);
+        std::iota(shuffled.begin(), shuffled.end(), -150'000);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{19937});
+        test_select("shuffled", shuffled);
+        test_select<int32_t, top_two::Greater<int32_t>>("shuffled_greater", shuffled);
+
+        auto ascending = shuffled;
+        std::sort(ascending.begin(), ascending.end());
+        test_select("ascending", ascending);
+
+        // many values equal to the pivot
+        test_select("heavy_duplicates", top_two::workloads::make_values(top_two::workloads::Workload::heavy_duplicates, 300'007, 19937));
+        test_select("all_equal", std::vector<int32_t>(100'000, 42));
+        test_select("doubles", std::vector<double>(shuffled.begin(), shuffled.end()));
+    }
+
+    std::cout << "\n\nsimd\n\n";
+    {
+        for (auto isa : {top_two::simd::Isa::scalar, top_two::simd::Isa::sse41, top_two::simd::Isa::avx2, top_two::simd::Isa::avx512})
+        {
+            if (!top_two::simd::is_supported(isa))
+            {
+                std::vector<int32_t> const values{6, 2, 8, 4, 3, 9, 1, 2, 4, 7};
+                bool accumulate_thrown = false;
+                try
+                {
+                    top_two::simd::accumulate(values, isa);
+                }
+                catch (std::invalid_argument const&)
+                {
+                    accumulate_thrown = true;
+                }
+                bool reduce_thrown = false;
+                try
+                {
+                    top_two::simd::reduce(values, isa);
+                }
+                catch (std::invalid_argument const&)
+                {
+                    reduce_thrown = true;
+                }
+                std::cout << top_two::simd::to_string(isa) << "/unsupported: "; check(true, accumulate_thrown && reduce_thrown);
+                continue;
+            }
+            std::string const isa_name = top_two::simd::to_string(isa);
+            test("accumulate/" + isa_name, [isa](auto const &values) { return top_two::simd::accumulate(values, isa); });
+            test("reduce/" + isa_name, [isa](auto const &values) { return top_two::simd::reduce(values, isa); });
+            test("reduce/span/" + isa_name, [isa](auto const &values) { return top_two::simd::reduce<int32_t>(std::span<int32_t const>(values), isa); });
+        }
+    }
+
+    std::cout << "\n\ndispatch\n\n";
+    {
+        test("dispatch", [](auto const &values) { return top_two::dispatch<int32_t>(values); });
+
+        std::vector<double> const doubles{6.0, 2.0, 8.0, 4.0, 3.0, 9.0, 1.0, 2.0, 4.0, 7.0};
+        std::cout << "dispatch/double: "; check(top_two::TBasicResult<double>{8.0, 9.0}, top_two::dispatch<double>(doubles));
+
+        using top_two::tuning::Variant;
+        top_two::tuning::TCalibration const calibration{top_two::default_pool().size(), top_two::simd::best_isa(),
+                                                        {{0, Variant::accumulate_adaptive}, {1'000, Variant::simd_accumulate}, {100'000, Variant::pool_reduce}}};
+        std::cout << "tuning/variant_for/0: "; check(true, calibration.variant_for(0) == Variant::accumulate_adaptive);
+        std::cout << "tuning/variant_for/999: "; check(true, calibration.variant_for(999) == Variant::accumulate_adaptive);
+        std::cout << "tuning/variant_for/1000: "; check(true, calibration.variant_for(1'000) == Variant::simd_accumulate);
+        std::cout << "tuning/variant_for/10000000: "; check(true, calibration.variant_for(10'000'000) == Variant::pool_reduce);
+
+        auto const path = std::string("/tmp/top_two_tests_calibration.int32");
+        top_two::tuning::save<int32_t>(calibration, path);
+        auto const loaded = top_two::tuning::load<int32_t>(path);
+        std::cout << "tuning/load: "; check(true, loaded && loaded->matches_host() && loaded->thresholds.size() == 3 && loaded->variant_for(100'000) == Variant::pool_reduce);
+        std::cout << "tuning/load/other_type: "; check(false, top_two::tuning::load<int16_t>(path).has_value());
+        std::remove(path.c_str());
+    }
+
+    std::cout << "\n\nfile\n\n";
+    {
+        // file sizes that are no multiple of the block size, plus a trailing partial value
+        auto const test_file = [](auto values, const std::string& type_name)
+        {
+            using T = typename decltype(values)::value_type;
+            std::string const path = "/tmp/top_two_tests_" + type_name + ".bin";
+            {
+                std::ofstream file(path, std::ios::binary);
+                file.write(reinterpret_cast<char const*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+                file.put('x');
+            }
+            auto const expected = top_two::sequential::accumulate<T>(values);
+            for (auto mode : {top_two::file::IoMode::mmap, top_two::file::IoMode::pread})
+            {
+                std::string const mode_name = mode == top_two::file::IoMode::mmap ? "mmap" : "pread";
+                for (size_t block_size : {size_t{4'096}, size_t{10'000}, size_t{1} << 20})
+                {
+                    std::cout << "file/" << type_name << "/" << mode_name << "/" << block_size << ": "; check(expected, top_two::file::reduce<T>(path, {mode, block_size}));
+                }
+            }
+            std::remove(path.c_str());
+        };
+
+        std::vector<int32_t> int32_values(100'003);
+        std::iota(int32_values.begin(), int32_values.end(), -50'000);
+        std::shuffle(int32_values.begin(), int32_values.end(), std::mt19937{19937});
+        test_file(int32_values, "int32");
+        test_file(std::vector<int64_t>(int32_values.begin(), int32_values.end()), "int64");
+
+        bool thrown = false;
+        try
+        {
+            top_two::file::reduce<int32_t>("/nonexistent/top_two.bin");
+        }
+        catch (std::system_error const&)
+        {
+            thrown = true;
+        }
+        std::cout << "file/missing: "; check(true, thrown);
+    }
+
+    std::cout << "\n\ntournament tree\n\n";
+    {
+        test_tournament_tree<2>(1);
+        test_tournament_tree<2>(1'003);
+        test_tournament_tree<8>(2);
+        test_tournament_tree<8>(10'000);
+        test_tournament_tree<16>(4'096);
+        std::cout << "tournament_tree/empty: "; check(top_two::TResult{}, top_two::TTournamentTree<int32_t>{}.top_two());
+        std::cout << "tournament_tree/empty_span: "; check(top_two::TResult{}, top_two::TTournamentTree<int32_t>(std::span<int32_t const>{}).top_two());
+    }
+
+    std::cout << "\n\nsliding window\n\n";
+    {
+        test_sliding_window(1);
+        test_sliding_window(2);
+        test_sliding_window(5);
+        test_sliding_window(100);
+        test_sliding_window<top_two::Greater<int32_t>>(37);
+        test_time_window();
+    }
+
+    std::cout << "\n\ncolumn file\n\n";
+    {
+        std::string const path = "/tmp/top_two_tests.column";
+        std::vector<int32_t> values(10'000);
+        std::iota(values.begin(), values.end(), -5'000);
+        std::shuffle(values.begin(), values.end(), std::mt19937{19937});
+
+        // appends that start and end in the middle of blocks of 1'000 values
+        top_two::column::TColumnFile<int32_t> writer(path, top_two::column::OpenMode::create, 1'000);
+        top_two::column::TColumnFile<int32_t> reader(path);
+        size_t appended = 0;
+        for (size_t chunk : {size_t{1}, size_t{999}, size_t{1'500}, size_t{37}, size_t{4'463}})
+        {
+            writer.append(std::span<int32_t const>{values.data() + appended, chunk});
+            appended += chunk;
+            auto const expected = top_two::sequential::accumulate<int32_t>(std::span<int32_t const>{values.data(), appended});
+            std::cout << "column/append/" << appended << ": "; check(expected, writer.query());
+            std::cout << "column/reader/" << appended << ": "; check(expected, reader.query());
+        }
+        std::cout << "column/blocks: "; check(size_t{7}, writer.n_blocks());
+        std::cout << "column/scan: "; check(writer.query(), writer.scan());
+        std::cout << "column/reopen: "; check(top_two::sequential::accumulate<int32_t>(std::span<int32_t const>{values.data(), appended}),
+                                             top_two::column::TColumnFile<int32_t>(path).query());
+
+        // the values of an interrupted append are not in the file header, the summary of their block is ignored
+        {
+            uint64_t const n_committed = appended - 5;
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(24);
+            file.write(reinterpret_cast<char const*>(&n_committed), sizeof(n_committed));
+        }
+        std::cout << "column/interrupted: "; check(top_two::sequential::accumulate<int32_t>(std::span<int32_t const>{values.data(), appended - 5}),
+                                                  top_two::column::TColumnFile<int32_t>(path).query());
+
+        bool thrown = false;
+        try
+        {
+            top_two::column::TColumnFile<int64_t> wrong_type(path);
+        }
+        catch (std::runtime_error const&)
+        {
+            thrown = true;
+        }
+        std::cout << "column/wrong_type: "; check(true, thrown);
+        std::remove(path.c_str());
+    }
+
+    std::cout << "\n\nshared memory shards\n\n";
+    {
+        std::vector<int32_t> values(100'003);
+        std::iota(values.begin(), values.end(), -50'000);
+        std::shuffle(values.begin(), values.end(), std::mt19937{19937});
+        auto const expected = top_two::sequential::accumulate<int32_t>(values);
+
+        size_t const n_shards = 4;
+        std::string const name = "/top_two_tests_" + std::to_string(::getpid());
+        top_two::shard::TSegment<int32_t> segment(name, top_two::shard::Role::coordinator, n_shards);
+        std::cout << "shard/nothing_published: "; check(size_t{0}, top_two::shard::merge(segment).n_published);
+
+        // every worker process reduces its shard of the inherited values, without copying them
+        auto const shard_size = (values.size() + n_shards - 1) / n_shards;
+        for (size_t shard = 0; shard < n_shards; ++shard)
+        {
+            if (::fork() == 0)
+            {
+                top_two::shard::TSegment<int32_t> worker(name, top_two::shard::Role::worker);
+                auto const first = shard * shard_size;
+                top_two::shard::publish<int32_t>(worker, shard, std::span<int32_t const>{values}.subspan(first, std::min(shard_size, values.size() - first)));
+                ::_exit(0);
+            }
+        }
+        auto const merged = top_two::shard::wait_and_merge(segment, std::chrono::seconds(10));
+        for (size_t shard = 0; shard < n_shards; ++shard)
+        {
+            ::wait(nullptr);
+        }
+        std::cout << "shard/forked/n_published: "; check(n_shards, merged.n_published);
+        std::cout << "shard/forked: "; check(expected, merged.result);
+
+        // a restarted worker replaces the partial of its first run
+        segment.publish(0, top_two::TResult{60'000, 70'000});
+        std::cout << "shard/restarted: "; check(top_two::TResult{60'000, 70'000}, top_two::shard::merge(segment).result);
+        std::cout << "shard/restarted/version: "; check(uint64_t{2}, segment.version(0));
+
+        // a worker that is killed in the middle of a publication leaves the buffer it writes odd;
+        // the restarted worker publishes into the same buffer
+        std::string const crash_name = name + "_crash";
+        top_two::shard::TSegment<int32_t> crash(crash_name, top_two::shard::Role::coordinator, 1);
+        auto const crashing = ::fork();
+        if (crashing == 0)
+        {
+            top_two::shard::TSegment<int32_t> worker(crash_name, top_two::shard::Role::worker);
+            worker.publish(0, top_two::TResult{1, 2});
+            // the first half of publication 2, like TSegment::publish, then the worker dies
+            auto const fd = ::shm_open(crash_name.c_str(), O_RDWR, 0);
+            auto *const slots = static_cast<top_two::shard::detail::TSlot<int32_t> *>(
+                ::mmap(nullptr, top_two::shard::detail::segment_size<int32_t>(1), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+            auto &buffer = slots[1].buffers[2 % 2];
+            buffer.sequence.fetch_add(1);
+            buffer.largest.store(100);
+            ::raise(SIGKILL);
+        }
+        int status = 0;
+        ::waitpid(crashing, &status, 0);
+        std::cout << "shard/killed: "; check(true, WIFSIGNALED(status));
+        std::cout << "shard/killed/previous_publication: "; check(top_two::TResult{1, 2}, top_two::shard::merge(crash).result);
+
+        auto const restarted = ::fork();
+        if (restarted == 0)
+        {
+            top_two::shard::TSegment<int32_t> worker(crash_name, top_two::shard::Role::worker);
+            worker.publish(0, top_two::TResult{3, 4});
+            ::_exit(0);
+        }
+        ::waitpid(restarted, nullptr, 0);
+        auto const after_restart = top_two::shard::wait_and_merge(crash, std::chrono::seconds(1));
+        std::cout << "shard/killed/restarted/n_published: "; check(size_t{1}, after_restart.n_published);
+        std::cout << "shard/killed/restarted: "; check(top_two::TResult{3, 4}, after_restart.result);
+
+        // a late shard is missing until it publishes
+        top_two::shard::TSegment<int32_t> late(name + "_late", top_two::shard::Role::coordinator, 2);
+        late.publish(1, top_two::TResult{1, 2});
+        auto const partial = top_two::shard::wait_and_merge(late, std::chrono::milliseconds(10));
+        std::cout << "shard/late/n_published: "; check(size_t{1}, partial.n_published);
+        std::cout << "shard/late: "; check(top_two::TResult{1, 2}, partial.result);
+        late.publish(0, top_two::TResult{3, 4});
+        std::cout << "shard/late/published: "; check(top_two::TResult{3, 4}, top_two::shard::merge(late).result);
+
+        bool thrown = false;
+        try
+        {
+            top_two::shard::TSegment<int64_t> wrong_type(name, top_two::shard::Role::worker);
+        }
+        catch (std::runtime_error const&)
+        {
+            thrown = true;
+        }
+        std::cout << "shard/wrong_type: "; check(true, thrown);
+    }
+
+    std::cout << "\n\nworkloads\n\n";
+    {
+        for (auto workload : top_two::workloads::all)
+        {
+            auto const values = top_two::workloads::make_values(workload, 5'000, 19937);
+            auto sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+            top_two::TResult const expected{sorted[sorted.size() - 2], sorted[sorted.size() - 1]};
+
+            std::string const workload_name = top_two::workloads::to_string(workload);
+            auto const run = [&](const std::string& algorithm_name, auto algorithm_callable)
+            {
+                std::cout << workload_name << "/" << algorithm_name << ": "; check(expected, algorithm_callable(values));
+            };
+            run("sequential::nth_element", top_two::sequential::nth_element<int32_t>);
+            run("sequential::max_element", top_two::sequential::max_element<int32_t>);
+            run("sequential::max_element_ben_deane", top_two::sequential::max_element_ben_deane<int32_t>);
+            run("sequential::accumulate", top_two::sequential::accumulate<int32_t>);
+            run("sequential::accumulate_branchless", top_two::sequential::accumulate_branchless<int32_t>);
+            run("sequential::accumulate_adaptive", top_two::sequential::accumulate_adaptive<int32_t>);
+            run("parallel::reduce", top_two::parallel::reduce<int32_t>);
+            run("simd::accumulate", [](auto const& v) { return top_two::simd::accumulate(v); });
+        }
+        std::cout << "workloads/seeded: "; check(true, top_two::workloads::make_values(top_two::workloads::Workload::zipf, 1'000, 7) == top_two::workloads::make_values(top_two::workloads::Workload::zipf, 1'000, 7));
+    }
+
+    std::cout << "\n\nload generator\n\n";
+    {
+        top_two::benchmark::THistogram<> histogram;
+        for (uint64_t value = 1; value <= 100'000; ++value)
+        {
+            histogram.record(value);
+        }
+        auto const within = [](uint64_t expected, uint64_t actual) { return actual >= expected && actual <= expected + expected / 64; };
+        std::cout << "histogram/count: "; check(uint64_t{100'000}, histogram.count());
+        std::cout << "histogram/empty: "; check(true, top_two::benchmark::THistogram<>{}.value_at_percentile(50.0) == 0);
+        std::cout << "histogram/p50: "; check(true, within(50'000, histogram.value_at_percentile(50.0)));
+        std::cout << "histogram/p99: "; check(true, within(99'000, histogram.value_at_percentile(99.0)));
+        std::cout << "histogram/p99.9: "; check(true, within(99'900, histogram.value_at_percentile(99.9)));
+        std::cout << "histogram/p100: "; check(uint64_t{100'000}, histogram.value_at_percentile(100.0));
+
+        top_two::benchmark::THistogram<> small;
+        for (uint64_t value = 0; value < 100; ++value)
+        {
+            small.record(value);
+        }
+        std::cout << "histogram/small_values: "; check(uint64_t{49}, small.value_at_percentile(50.0));
+        small.merge(histogram);
+        std::cout << "histogram/merge: "; check(uint64_t{100'100}, small.count());
+
+        std::vector<size_t> calls(3, 0);
+        auto const result = top_two::benchmark::run_load({3, 0.0, std::chrono::milliseconds(20)}, [&calls](size_t client) { ++calls[client]; });
+        std::cout << "run_load/all_clients: "; check(true, std::all_of(calls.cbegin(), calls.cend(), [](size_t n) { return n > 0; }));
+        std::cout << "run_load/recorded: "; check(std::accumulate(calls.cbegin(), calls.cend(), size_t{0}), result.n_requests);
+
+        // 50 requests per second for 100 ms, every scheduled request is sent
+        auto const paced = top_two::benchmark::run_load({1, 50.0, std::chrono::milliseconds(100)}, [](size_t) {});
+        std::cout << "run_load/paced: "; check(size_t{5}, paced.n_requests);
+    }
+
+    std::cout << "\n\nbenchmark\n\n";
+    {
+        auto const statistics = top_two::benchmark::summarize({7.0, 3.0, 10.0, 1.0, 5.0, 9.0, 2.0, 6.0, 8.0, 4.0});
+        std::cout << "summarize/median: "; check(5.5, statistics.median);
+        std::cout << "summarize/mad: "; check(2.5, statistics.mad);
+        std::cout << "summarize/ci_low: "; check(1.0, statistics.ci_low);
+        std::cout << "summarize/ci_high: "; check(10.0, statistics.ci_high);
+
+        size_t n_setups = 0, n_runs = 0;
+        auto const samples = top_two::benchmark::sample([&n_setups] { ++n_setups; }, [&n_runs] { ++n_runs; }, 2, 5);
+        std::cout << "sample/trials: "; check(size_t{5}, samples.size());
+        std::cout << "sample/runs: "; check(size_t{7}, n_runs);
+        std::cout << "sample/setups: "; check(size_t{7}, n_setups);
+    }
+
     return 0;
 }
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "algorithms.h"
+#include "simd.h"
+
+namespace top_two
+{
+    struct TPoolConfig
+    {
+        size_t n_threads = 0;       // including the calling thread, 0 means one per hardware thread
+        size_t grain_size = 1 << 14; // elements per block, inputs of at most one block are reduced inline
+        bool pin_threads = false;   // pin worker i to the i-th CPU of the process affinity mask
+    };
+
+    // Persistent pool for the parallel reductions. The calling thread takes part as worker 0.
+    //
+    // The blocks of an input are statically partitioned into one contiguous range per worker. A worker
+    // first reduces its own range and then steals blocks from the ranges of the other workers. Memory
+    // initialized with for_each_block() uses the same partition, so with pinned threads each page is
+    // reduced by the worker that touched it first, i.e. on its own NUMA node.
+    //
+    // Jobs are serialized: concurrent callers of one pool wait for each other.
+    class TThreadPool
+    {
+    public:
+        explicit TThreadPool(TPoolConfig config_ = {}) : config(config_)
+        {
+            if (config.n_threads == 0)
+            {
+                config.n_threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            config.grain_size = std::max<size_t>(config.grain_size, 1);
+            ranges = std::vector<TRange>(config.n_threads);
+
+            auto const cpus = allowed_cpus();
+            for (size_t worker = 1; worker < config.n_threads; ++worker)
+            {
+                auto const cpu = cpus.empty() ? -1 : cpus[worker % cpus.size()];
+                threads.emplace_back([this, worker, cpu] { work(worker, cpu); });
+            }
+        }
+
+        ~TThreadPool()
+        {
+            {
+                std::lock_guard const lock(mutex);
+                stop = true;
+                generation.fetch_add(1, std::memory_order_release);
+            }
+            wake.notify_all();
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        TThreadPool(TThreadPool const &) = delete;
+        TThreadPool &operator=(TThreadPool const &) = delete;
+
+        size_t size() const { return config.n_threads; }
+        size_t grain_size() const { return config.grain_size; }
+
+        // Calls block(first, last) for the blocks of [0, n) with the static partition and without
+        // stealing, e.g. to initialize a freshly allocated buffer on the NUMA node of its reducer.
+        template <typename Block>
+        void for_each_block(size_t n, Block block, size_t grain_size = 0)
+        {
+            auto const grain = grain_size == 0 ? config.grain_size : grain_size;
+            auto const n_blocks = (n + grain - 1) / grain;
+
+            std::lock_guard const exclusive(run_mutex);
+            run([&](size_t worker)
+                {
+                    auto const [first_block, last_block] = partition(n_blocks, worker);
+                    for (auto b = first_block; b < last_block; ++b)
+                    {
+                        block(b * grain, std::min(n, (b + 1) * grain));
+                    }
+                });
+        }
+
+        // Reduces [0, n) block by block with reduce_block(first, last) and combines the block results
+        // with merge. TRes{} must be the identity of merge.
+        template <typename TRes, typename ReduceBlock, typename Merge>
+        TRes reduce(size_t n, TRes init, ReduceBlock reduce_block, Merge merge, size_t grain_size = 0)
+        {
+            auto const grain = grain_size == 0 ? config.grain_size : grain_size;
+            if (n <= grain || size() == 1)
+            {
+                return merge(init, reduce_block(size_t{0}, n));
+            }
+
+            auto const n_blocks = (n + grain - 1) / grain;
+
+            std::lock_guard const exclusive(run_mutex);
+            for (size_t worker = 0; worker < size(); ++worker)
+            {
+                auto const [first_block, last_block] = partition(n_blocks, worker);
+                ranges[worker].next.store(first_block, std::memory_order_relaxed);
+                ranges[worker].last = last_block;
+            }
+
+            std::vector<TPartial<TRes>> partials(size());
+            run([&](size_t worker)
+                {
+                    TRes partial{};
+                    size_t b = 0;
+                    while (take(worker, b))
+                    {
+                        partial = merge(partial, reduce_block(b * grain, std::min(n, (b + 1) * grain)));
+                    }
+                    partials[worker].result = partial;
+                });
+
+            return std::accumulate(partials.cbegin(), partials.cend(), init,
+                                   [&merge](TRes const &result, TPartial<TRes> const &partial) { return merge(result, partial.result); });
+        }
+
+    private:
+        // Blocks [next, last) of a worker's range. Owner and thieves both take blocks from the front.
+        struct alignas(64) TRange
+        {
+            std::atomic<size_t> next = 0;
+            size_t last = 0;
+        };
+
+        template <typename TRes>
+        struct alignas(64) TPartial
+        {
+            TRes result;
+        };
+
+        static std::pair<size_t, size_t> partition(size_t n_blocks, size_t worker, size_t n_workers)
+        {
+            return {n_blocks * worker / n_workers, n_blocks * (worker + 1) / n_workers};
+        }
+
+        std::pair<size_t, size_t> partition(size_t n_blocks, size_t worker) const
+        {
+            return partition(n_blocks, worker, size());
+        }
+
+        // Own range first, then the ranges of the other workers in round-robin order.
+        bool take(size_t worker, size_t &block)
+        {
+            for (size_t k = 0; k < size(); ++k)
+            {
+                auto &range = ranges[(worker + k) % size()];
+                if (range.next.load(std::memory_order_relaxed) >= range.last)
+                {
+                    continue;
+                }
+                block = range.next.fetch_add(1, std::memory_order_relaxed);
+                if (block < range.last)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Runs job(worker) on every worker and waits for all of them. The caller holds run_mutex.
+        template <typename Job>
+        void run(Job &&job)
+        {
+            {
+                std::lock_guard const lock(mutex);
+                task = [](void *context, size_t worker) { (*static_cast<std::remove_reference_t<Job> *>(context))(worker); };
+                task_context = &job;
+                pending.store(threads.size(), std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_release);
+            }
+            wake.notify_all();
+
+            job(0);
+
+            std::unique_lock lock(mutex);
+            done.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+        }
+
+        void work(size_t worker, int cpu)
+        {
+            if (config.pin_threads && cpu >= 0)
+            {
+                pin(cpu);
+            }
+
+            // generation is 0 until the constructor has returned, even if this thread starts late
+            size_t seen = 0;
+            while (true)
+            {
+                // jobs often follow each other closely, spinning briefly avoids the futex wake-up
+                for (size_t spin = 0; spin < 4'096 && generation.load(std::memory_order_acquire) == seen; ++spin)
+                {
+                    cpu_relax();
+                }
+
+                void (*current_task)(void *, size_t) = nullptr;
+                void *current_context = nullptr;
+                {
+                    std::unique_lock lock(mutex);
+                    wake.wait(lock, [this, seen] { return generation.load(std::memory_order_acquire) != seen; });
+                    seen = generation.load(std::memory_order_acquire);
+                    if (stop)
+                    {
+                        return;
+                    }
+                    current_task = task;
+                    current_context = task_context;
+                }
+
+                current_task(current_context, worker);
+
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard const lock(mutex);
+                    done.notify_one();
+                }
+            }
+        }
+
+        static void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+
+        static std::vector<int> allowed_cpus()
+        {
+            std::vector<int> cpus;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                {
+                    if (CPU_ISSET(cpu, &set))
+                    {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif
+            return cpus;
+        }
+
+        static void pin(int cpu)
+        {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+        }
+
+        TPoolConfig config;
+        std::vector<TRange> ranges;
+        std::vector<std::thread> threads;
+
+        std::mutex run_mutex;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::atomic<size_t> generation = 0;
+        std::atomic<size_t> pending = 0;
+        bool stop = false;
+
+        void (*task)(void *, size_t) = nullptr;
+        void *task_context = nullptr;
+    };
+
+    // Pool with one worker per hardware thread, created on first use.
+    inline TThreadPool &default_pool()
+    {
+        static TThreadPool pool;
+        return pool;
+    }
+
+    namespace parallel
+    {
+        namespace pool
+        {
+            template <typename T = int32_t, typename Compare = Less<T>>
+            TBasicResult<T, Compare> reduce(std::span<T const> values, TThreadPool &pool = default_pool(), size_t grain_size = 0)
+            {
+                auto const reduce_block = [values](size_t first, size_t last) -> TBasicResult<T, Compare>
+                {
+                    if constexpr (std::is_same_v<Compare, Less<T>>)
+                    {
+                        return simd::detail::kernel<T>(simd::best_isa())(values.data() + first, values.data() + last);
+                    }
+                    else
+                    {
+                        return std::accumulate(values.begin() + first, values.begin() + last, TBasicResult<T, Compare>{}, ReduceOp<T, Compare>{});
+                    }
+                };
+
+                return detail::finish(pool.reduce(values.size(), TBasicResult<T, Compare>{}, reduce_block, ReduceOp<T, Compare>{}, grain_size));
+            }
+
+            template <typename T = int32_t, typename Compare = Less<T>>
+            TBasicResult<T, Compare> transform_reduce(std::span<T const> values, TThreadPool &pool = default_pool(), size_t grain_size = 0)
+            {
+                auto const transform_op = [](T value) -> TBasicResult<T, Compare>
+                {
+                    return {Compare::lowest(), value};
+                };
+
+                auto const reduce_block = [values, transform_op](size_t first, size_t last) -> TBasicResult<T, Compare>
+                {
+                    return std::transform_reduce(values.begin() + first, values.begin() + last, TBasicResult<T, Compare>{}, ReduceOp<T, Compare>{},
+                                                 transform_op);
+                };
+
+                return detail::finish(pool.reduce(values.size(), TBasicResult<T, Compare>{}, reduce_block, ReduceOp<T, Compare>{}, grain_size));
+            }
+        }
+    }
+}
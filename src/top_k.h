@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "algorithms.h"
+
+namespace top_two
+{
+    // The K largest values in ascending order, i.e. values[K - 1] is the largest value.
+    // The array is small enough to stay in registers and is updated by an unrolled insertion.
+    template <size_t K, typename T = int32_t, typename Compare = Less<T>>
+    struct TTopK
+    {
+        static_assert(K > 0, "TTopK needs at least one value");
+
+        using value_type = T;
+        using compare_type = Compare;
+
+        std::array<T, K> values = lowest();
+
+        bool operator==(const TTopK &other) const
+        {
+            Compare const less;
+            return std::equal(values.begin(), values.end(), other.values.cbegin(),
+                              [less](T lhs, T rhs) { return !less(lhs, rhs) && !less(rhs, lhs); });
+        }
+
+        T largest() const { return values[K - 1]; }
+        T kth_largest() const { return values[0]; }
+
+        TTopK() = default;
+        TTopK(std::array<T, K> const &values_) : values(values_) {}
+        TTopK(T val) : values(lowest()) { values[K - 1] = val; }  // necessary to satisfy static_assert in implementation of std::reduce (fixed in g++ 12.1)
+
+        // Most values are not among the K largest ones and are rejected by the first comparison.
+        // Otherwise the K-th largest value is replaced and bubbled up by a chain of compare-exchanges.
+        void insert(T value)
+        {
+            if (!Compare{}(values[0], value))
+            {
+                return;
+            }
+            values[0] = value;
+            bubble_up(std::make_index_sequence<K - 1>{});
+        }
+
+    private:
+        static std::array<T, K> lowest()
+        {
+            std::array<T, K> values;
+            values.fill(Compare::lowest());
+            return values;
+        }
+
+        template <size_t... Is>
+        void bubble_up(std::index_sequence<Is...>)
+        {
+            (compare_exchange<Is>(), ...);
+        }
+
+        template <size_t I>
+        void compare_exchange()
+        {
+            auto const low = std::min(values[I], values[I + 1], Compare{});
+            auto const high = std::max(values[I], values[I + 1], Compare{});
+            values[I] = low;
+            values[I + 1] = high;
+        }
+    };
+
+    namespace detail
+    {
+        // NanPolicy::propagate for TTopK, see detail::finish for TBasicResult
+        template <size_t K, typename T, typename Compare>
+        TTopK<K, T, Compare> finish(TTopK<K, T, Compare> result)
+        {
+            if constexpr (std::is_floating_point_v<T> && Compare::nan_policy == NanPolicy::propagate)
+            {
+                if (result.largest() != result.largest())
+                {
+                    result.values.fill(result.largest());
+                }
+            }
+            return result;
+        }
+    }
+
+    namespace top_k
+    {
+        // Merges two sorted arrays from the top and keeps the K largest values.
+        template <size_t K, typename T, typename Compare>
+        TTopK<K, T, Compare> merge(TTopK<K, T, Compare> const &lhs, TTopK<K, T, Compare> const &rhs)
+        {
+            Compare const less;
+            if (!less(lhs.kth_largest(), rhs.largest()))
+            {
+                return lhs;
+            }
+            else if (!less(rhs.kth_largest(), lhs.largest()))
+            {
+                return rhs;
+            }
+
+            TTopK<K, T, Compare> result;
+            size_t l = K;
+            size_t r = K;
+            for (size_t i = K; i-- > 0;)
+            {
+                result.values[i] = !less(lhs.values[l - 1], rhs.values[r - 1]) ? lhs.values[--l] : rhs.values[--r];
+            }
+            return result;
+        }
+
+        namespace sequential
+        {
+            template <size_t K, typename T, typename Compare = Less<T>>
+            TTopK<K, T, Compare> accumulate(std::span<T const> values)
+            {
+                auto const accumulate_op =
+                    [](TTopK<K, T, Compare> result, T value) -> TTopK<K, T, Compare>
+                {
+                    result.insert(value);
+                    return result;
+                };
+
+                return detail::finish(std::accumulate(values.begin(), values.end(), TTopK<K, T, Compare>{}, accumulate_op));
+            }
+
+            template <size_t K, typename T, typename Compare = Less<T>>
+            TTopK<K, T, Compare> transform_reduce(std::span<T const> values)
+            {
+                auto const transform_op = [](T value) -> TTopK<K, T, Compare>
+                {
+                    return {value};
+                };
+
+                return detail::finish(std::transform_reduce(values.begin(), values.end(), TTopK<K, T, Compare>{}, merge<K, T, Compare>,
+                                                            transform_op));
+            }
+
+            // The std::vector overloads deduce T from the argument
+            template <size_t K, typename T, typename Compare = Less<T>>
+            TTopK<K, T, Compare> accumulate(std::vector<T> const &values)
+            {
+                return accumulate<K, T, Compare>(std::span<T const>(values));
+            }
+
+            template <size_t K, typename T, typename Compare = Less<T>>
+            TTopK<K, T, Compare> transform_reduce(std::vector<T> const &values)
+            {
+                return transform_reduce<K, T, Compare>(std::span<T const>(values));
+            }
+        }
+
+        namespace parallel
+        {
+            template <size_t K, typename T = int32_t, typename Compare = Less<T>>
+            struct ReduceOp
+            {
+                TTopK<K, T, Compare> operator()(T lhs, T rhs) const
+                {
+                    TTopK<K, T, Compare> result;
+                    result.insert(lhs);
+                    result.insert(rhs);
+                    return result;
+                }
+                TTopK<K, T, Compare> operator()(TTopK<K, T, Compare> result, T value) const
+                {
+                    result.insert(value);
+                    return result;
+                }
+                TTopK<K, T, Compare> operator()(T value, TTopK<K, T, Compare> result) const
+                {
+                    result.insert(value);
+                    return result;
+                }
+                TTopK<K, T, Compare> operator()(TTopK<K, T, Compare> const &lhs, TTopK<K, T, Compare> const &rhs) const
+                {
+                    return merge(lhs, rhs);
+                }
+            };
+
+            template <size_t K, typename T, typename Compare = Less<T>, typename Backend = backend::Std<>>
+            TTopK<K, T, Compare> reduce(std::span<T const> values)
+            {
+                return detail::finish(Backend::reduce(values.begin(), values.end(), TTopK<K, T, Compare>{}, ReduceOp<K, T, Compare>{}));
+            }
+
+            template <size_t K, typename T, typename Compare = Less<T>, typename Backend = backend::Std<>>
+            TTopK<K, T, Compare> transform_reduce(std::span<T const> values)
+            {
+                auto const transform_op = [](T value) -> TTopK<K, T, Compare>
+                {
+                    return {value};
+                };
+
+                return detail::finish(Backend::transform_reduce(values.begin(), values.end(), TTopK<K, T, Compare>{}, merge<K, T, Compare>, transform_op));
+            }
+
+            template <size_t K, typename T, typename Compare = Less<T>, typename Backend = backend::Std<>>
+            TTopK<K, T, Compare> reduce(std::vector<T> const &values)
+            {
+                return reduce<K, T, Compare, Backend>(std::span<T const>(values));
+            }
+
+            template <size_t K, typename T, typename Compare = Less<T>, typename Backend = backend::Std<>>
+            TTopK<K, T, Compare> transform_reduce(std::vector<T> const &values)
+            {
+                return transform_reduce<K, T, Compare, Backend>(std::span<T const>(values));
+            }
+        }
+    }
+}
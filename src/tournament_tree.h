@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "algorithms.h"
+
+namespace top_two
+{
+    // Top two of an array whose elements change, without a pass over the whole array per query.
+    // The values are grouped into nodes of NFanOut consecutive values, and NFanOut consecutive nodes
+    // into a parent node, up to a single root. Every node holds the top two of its values, merged
+    // with parallel::ReduceOp. A level is stored contiguously, so the children of a node share cache
+    // lines. A query returns the root in O(1), a point update recomputes one node per level, i.e.
+    // O(NFanOut * log_NFanOut(n)).
+    template <typename T = int32_t, typename Compare = Less<T>, size_t NFanOut = 8>
+    class TTournamentTree
+    {
+        static_assert(NFanOut >= 2, "TTournamentTree needs a fan-out of at least two");
+
+    public:
+        using TRes = TBasicResult<T, Compare>;
+
+        struct TUpdate
+        {
+            size_t index;
+            T value;
+        };
+
+        TTournamentTree() = default;
+
+        explicit TTournamentTree(std::span<T const> values_) : values(values_.begin(), values_.end())
+        {
+            // an empty tree has no levels, like a default constructed one
+            if (values.empty())
+            {
+                return;
+            }
+            auto size = values.size();
+            do
+            {
+                size = (size + NFanOut - 1) / NFanOut;
+                levels.emplace_back(size);
+            } while (size > 1);
+
+            for (size_t node = 0; node < levels[0].size(); ++node)
+            {
+                levels[0][node] = reduce_values(node);
+            }
+            for (size_t level = 1; level < levels.size(); ++level)
+            {
+                for (size_t node = 0; node < levels[level].size(); ++node)
+                {
+                    levels[level][node] = reduce_children(level, node);
+                }
+            }
+        }
+
+        size_t size() const { return values.size(); }
+
+        T operator[](size_t index) const { return values[index]; }
+
+        std::span<T const> data() const { return values; }
+
+        // Top two of all values, O(1)
+        TRes top_two() const
+        {
+            return levels.empty() ? TRes{} : detail::finish(levels.back()[0]);
+        }
+
+        // Sets one value and recomputes the nodes on the path to the root
+        void update(size_t index, T value)
+        {
+            values[index] = value;
+            auto node = index / NFanOut;
+            levels[0][node] = reduce_values(node);
+            for (size_t level = 1; level < levels.size(); ++level)
+            {
+                node /= NFanOut;
+                levels[level][node] = reduce_children(level, node);
+            }
+        }
+
+        // Sets all values first, then recomputes every changed node once per level. Updates of
+        // values in the same node, or of nodes with the same parent, share the recomputation.
+        // If an index occurs more than once, the last update wins.
+        void update(std::span<TUpdate const> updates)
+        {
+            std::vector<size_t> nodes;
+            nodes.reserve(updates.size());
+            for (auto const &update : updates)
+            {
+                values[update.index] = update.value;
+                nodes.push_back(update.index / NFanOut);
+            }
+            std::sort(nodes.begin(), nodes.end());
+            nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+            for (auto node : nodes)
+            {
+                levels[0][node] = reduce_values(node);
+            }
+            for (size_t level = 1; level < levels.size(); ++level)
+            {
+                // the nodes are sorted, so equal parents are adjacent
+                for (auto &node : nodes)
+                {
+                    node /= NFanOut;
+                }
+                nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+                for (auto node : nodes)
+                {
+                    levels[level][node] = reduce_children(level, node);
+                }
+            }
+        }
+
+    private:
+        TRes reduce_values(size_t node) const
+        {
+            auto const first = values.cbegin() + node * NFanOut;
+            auto const last = values.cbegin() + std::min(values.size(), (node + 1) * NFanOut);
+            return std::accumulate(first, last, TRes{}, parallel::ReduceOp<T, Compare>{});
+        }
+
+        TRes reduce_children(size_t level, size_t node) const
+        {
+            auto const &children = levels[level - 1];
+            auto const first = children.cbegin() + node * NFanOut;
+            auto const last = children.cbegin() + std::min(children.size(), (node + 1) * NFanOut);
+            return std::accumulate(first, last, TRes{}, parallel::ReduceOp<T, Compare>{});
+        }
+
+        std::vector<T> values;
+        std::vector<std::vector<TRes>> levels; // levels[0] summarizes the values, levels.back() is the root
+    };
+}
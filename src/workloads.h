@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace top_two
+{
+    // Input layouts for the benchmark drivers. Every generator is seeded, so a workload of a given
+    // size and seed is the same on every run.
+    namespace workloads
+    {
+        enum class Workload
+        {
+            shuffled,         // permutation of 0 .. size - 1, the layout of make_dataset
+            sorted,           // 0 .. size - 1
+            reverse_sorted,   // size - 1 .. 0
+            nearly_sorted,    // sorted, then 1% of the values swapped with a random partner
+            heavy_duplicates, // 16 distinct values
+            all_equal,        // size copies of one value
+            zipf,             // Zipf distributed with exponent 1 over 0 .. size - 1, small values are frequent
+            adversarial,      // every value is a new maximum or small with probability 1/2 each
+            max_at_end        // shuffled, but the largest value is the last one
+        };
+
+        constexpr std::array all{Workload::shuffled, Workload::sorted, Workload::reverse_sorted, Workload::nearly_sorted,
+                                 Workload::heavy_duplicates, Workload::all_equal, Workload::zipf, Workload::adversarial,
+                                 Workload::max_at_end};
+
+        inline char const *to_string(Workload workload)
+        {
+            switch (workload)
+            {
+            case Workload::sorted:
+                return "sorted";
+            case Workload::reverse_sorted:
+                return "reverse_sorted";
+            case Workload::nearly_sorted:
+                return "nearly_sorted";
+            case Workload::heavy_duplicates:
+                return "heavy_duplicates";
+            case Workload::all_equal:
+                return "all_equal";
+            case Workload::zipf:
+                return "zipf";
+            case Workload::adversarial:
+                return "adversarial";
+            case Workload::max_at_end:
+                return "max_at_end";
+            default:
+                return "shuffled";
+            }
+        }
+
+        inline std::vector<int32_t> make_values(Workload workload, size_t size, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::vector<int32_t> values(size);
+            std::iota(values.begin(), values.end(), 0);
+            if (size == 0)
+            {
+                return values;
+            }
+
+            switch (workload)
+            {
+            case Workload::shuffled:
+                std::shuffle(values.begin(), values.end(), rng);
+                break;
+            case Workload::sorted:
+                break;
+            case Workload::reverse_sorted:
+                std::reverse(values.begin(), values.end());
+                break;
+            case Workload::nearly_sorted:
+            {
+                std::uniform_int_distribution<size_t> position(0, size - 1);
+                for (size_t i = 0; i < size / 100; ++i)
+                {
+                    std::swap(values[position(rng)], values[position(rng)]);
+                }
+                break;
+            }
+            case Workload::heavy_duplicates:
+            {
+                std::uniform_int_distribution<int32_t> value(0, 15);
+                std::generate(values.begin(), values.end(), [&] { return value(rng); });
+                break;
+            }
+            case Workload::all_equal:
+                std::fill(values.begin(), values.end(), 42);
+                break;
+            case Workload::zipf:
+            {
+                // inverse transform sampling with the cumulative weights 1/1 + 1/2 + ... + 1/(k+1)
+                std::vector<double> cumulative(size);
+                double sum = 0.0;
+                for (size_t k = 0; k < size; ++k)
+                {
+                    sum += 1.0 / static_cast<double>(k + 1);
+                    cumulative[k] = sum;
+                }
+                std::uniform_real_distribution<double> uniform(0.0, sum);
+                std::generate(values.begin(), values.end(), [&]
+                              { return static_cast<int32_t>(std::lower_bound(cumulative.begin(), cumulative.end() - 1, uniform(rng)) - cumulative.begin()); });
+                break;
+            }
+            case Workload::adversarial:
+            {
+                // the branch on a new top two of accumulate is taken at random
+                std::bernoulli_distribution new_maximum(0.5);
+                int32_t maximum = 0;
+                for (auto &value : values)
+                {
+                    value = new_maximum(rng) ? ++maximum : 0;
+                }
+                break;
+            }
+            case Workload::max_at_end:
+                std::shuffle(values.begin(), values.end(), rng);
+                std::iter_swap(std::max_element(values.begin(), values.end()), values.end() - 1);
+                break;
+            }
+            return values;
+        }
+
+        // n_permutations inputs with the seeds seed, seed + 1, ...; deterministic layouts like sorted
+        // yield n_permutations equal inputs.
+        inline TDataset make_dataset(Workload workload, size_t size, size_t n_permutations, uint32_t seed = 19937)
+        {
+            TDataset dataset;
+            dataset.reserve(n_permutations);
+            for (size_t i = 0; i < n_permutations; ++i)
+            {
+                dataset.push_back(make_values(workload, size, seed + static_cast<uint32_t>(i)));
+            }
+            return dataset;
+        }
+    }
+}